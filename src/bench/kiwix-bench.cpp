@@ -0,0 +1,585 @@
+/*
+ * Copyright 2026 Kiwix <contact@kiwix.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+
+#include <docopt/docopt.h>
+#include <kiwix/manager.h>
+#include <kiwix/name_mapper.h>
+#include <kiwix/server.h>
+#include <kiwix/tools.h>
+#include <zim/archive.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "../book_loader.h"
+#include "../json.h"
+#include "../version.h"
+
+// Older version of docopt doesn't declare Options. Let's declare it ourself.
+using Options = std::map<std::string, docopt::value>;
+
+static const char USAGE[] =
+R"(Benchmark the Kiwix HTTP server
+
+Start a kiwix-serve server on the loopback interface, send it a mix of requests
+from concurrent clients and report the throughput and latencies as JSON.
+
+Usage:
+  kiwix-bench [options] ZIMPATH ...
+  kiwix-bench -h | --help
+  kiwix-bench -V | --version
+
+Arguments:
+  ZIMPATH   ZIM file path(s) to serve
+
+Options:
+  -c <levels> --concurrency=<levels>  Comma separated numbers of concurrent clients to benchmark [default: 1,4,16]
+  -n <count> --requests=<count>       Number of requests sent for each concurrency level [default: 1000]
+  -m <kinds> --mix=<kinds>            Comma separated kinds of requests to send: content, suggest, search, catalog [default: content,suggest,search,catalog]
+  -u <path> --urls=<path>             Replay the URLs listed (one per line) in this file instead of the mix
+  -t <threads> --threads=<threads>    Number of threads of the server [default: 4]
+  -o <path> --output=<path>           Write the JSON report to this file instead of STDOUT
+  --seed=<seed>                       Seed of the random generation of the requests [default: 0]
+  -h --help                           Print this help
+  -V --version                        Print software version
+)";
+
+struct Request {
+  std::string kind;
+  std::string url;
+};
+
+struct Sample {
+  const Request* request;
+  double latency; // in milliseconds
+  bool ok;
+  size_t bytes;
+};
+
+/* Blocking HTTP/1.1 client keeping its connection alive */
+class HttpClient
+{
+ public:
+  explicit HttpClient(int port) : m_port(port) {}
+  ~HttpClient() { disconnect(); }
+
+  /* Returns the HTTP status code, or 0 if the request failed */
+  int get(const std::string& url, size_t& bytes);
+
+ private:
+  bool connect();
+  void disconnect();
+  bool fill();
+  bool readLine(std::string& line);
+  bool readBytes(size_t count);
+  bool readResponse(int& status, size_t& bytes);
+
+  int m_port;
+  int m_fd = -1;
+  std::string m_buffer;
+  bool m_keepAlive = true;
+};
+
+bool HttpClient::connect()
+{
+  m_fd = socket(AF_INET, SOCK_STREAM, 0);
+  if (m_fd < 0) {
+    return false;
+  }
+  const int on = 1;
+  setsockopt(m_fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(m_port);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  if (::connect(m_fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) != 0) {
+    disconnect();
+    return false;
+  }
+  m_buffer.clear();
+  return true;
+}
+
+void HttpClient::disconnect()
+{
+  if (m_fd >= 0) {
+    close(m_fd);
+    m_fd = -1;
+  }
+}
+
+bool HttpClient::fill()
+{
+  char buffer[16 * 1024];
+  const auto len = recv(m_fd, buffer, sizeof(buffer), 0);
+  if (len <= 0) {
+    return false;
+  }
+  m_buffer.append(buffer, len);
+  return true;
+}
+
+bool HttpClient::readLine(std::string& line)
+{
+  size_t end;
+  while ((end = m_buffer.find("\r\n")) == std::string::npos) {
+    if (!fill()) {
+      return false;
+    }
+  }
+  line = m_buffer.substr(0, end);
+  m_buffer.erase(0, end + 2);
+  return true;
+}
+
+bool HttpClient::readBytes(size_t count)
+{
+  while (m_buffer.size() < count) {
+    if (!fill()) {
+      return false;
+    }
+  }
+  m_buffer.erase(0, count);
+  return true;
+}
+
+bool HttpClient::readResponse(int& status, size_t& bytes)
+{
+  std::string line;
+  if (!readLine(line) || line.compare(0, 5, "HTTP/") != 0) {
+    return false;
+  }
+  status = std::atoi(line.c_str() + line.find(' ') + 1);
+
+  long contentLength = -1;
+  bool chunked = false;
+  m_keepAlive = true;
+  while (readLine(line) && !line.empty()) {
+    std::transform(line.begin(), line.end(), line.begin(), ::tolower);
+    if (line.compare(0, 15, "content-length:") == 0) {
+      contentLength = std::atol(line.c_str() + 15);
+    } else if (line.compare(0, 18, "transfer-encoding:") == 0) {
+      chunked = line.find("chunked") != std::string::npos;
+    } else if (line.compare(0, 11, "connection:") == 0) {
+      m_keepAlive = line.find("close") == std::string::npos;
+    }
+  }
+
+  bytes = 0;
+  if (chunked) {
+    while (readLine(line)) {
+      const size_t size = std::strtoul(line.c_str(), nullptr, 16);
+      if (size == 0) {
+        return readLine(line);
+      }
+      if (!readBytes(size) || !readLine(line)) {
+        return false;
+      }
+      bytes += size;
+    }
+    return false;
+  }
+  if (contentLength >= 0) {
+    bytes = contentLength;
+    return readBytes(contentLength);
+  }
+  // Body delimited by the end of the connection
+  while (fill()) {}
+  bytes = m_buffer.size();
+  m_buffer.clear();
+  m_keepAlive = false;
+  return true;
+}
+
+int HttpClient::get(const std::string& url, size_t& bytes)
+{
+  const std::string request = "GET " + url + " HTTP/1.1\r\n"
+                              "Host: localhost\r\n"
+                              "Accept-Encoding: gzip, deflate\r\n"
+                              "\r\n";
+  // Retry once if a kept alive connection was closed by the server
+  for (int attempt = 0; attempt < 2; attempt++) {
+    if (m_fd < 0 && !connect()) {
+      return 0;
+    }
+    int status = 0;
+    if (send(m_fd, request.data(), request.size(), MSG_NOSIGNAL) == ssize_t(request.size())
+     && readResponse(status, bytes)) {
+      if (!m_keepAlive) {
+        disconnect();
+      }
+      return status;
+    }
+    disconnect();
+  }
+  return 0;
+}
+
+std::string urlEncode(const std::string& str, bool keepSlashes)
+{
+  std::string out;
+  for (const char c : str) {
+    if (isalnum(static_cast<unsigned char>(c)) || strchr("-_.~", c) || (keepSlashes && c == '/')) {
+      out += c;
+    } else {
+      char buf[4];
+      snprintf(buf, sizeof(buf), "%%%02X", static_cast<unsigned char>(c));
+      out += buf;
+    }
+  }
+  return out;
+}
+
+/* Find a free port on the loopback interface */
+int findFreePort()
+{
+  const int fd = socket(AF_INET, SOCK_STREAM, 0);
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  socklen_t len = sizeof(addr);
+  int port = 0;
+  if (bind(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) == 0
+   && getsockname(fd, reinterpret_cast<struct sockaddr*>(&addr), &len) == 0) {
+    port = ntohs(addr.sin_port);
+  }
+  close(fd);
+  return port;
+}
+
+/* Build `count` requests of the given kinds against the served books */
+std::vector<Request> generateRequests(const kiwix::Library& library,
+                                      kiwix::NameMapper& nameMapper,
+                                      const std::vector<std::string>& kinds,
+                                      size_t count,
+                                      std::mt19937& random)
+{
+  struct BookSample {
+    std::string name;
+    std::vector<std::string> paths;
+    std::vector<std::string> words;
+  };
+  std::vector<BookSample> books;
+  for (const auto& id : library.getBooksIds()) {
+    const auto& book = library.getBookById(id);
+    BookSample sample;
+    sample.name = nameMapper.getNameForId(id);
+    try {
+      zim::Archive archive(book.getPath());
+      for (int i = 0; i < 256; i++) {
+        const auto entry = archive.getRandomEntry();
+        sample.paths.push_back(entry.getPath());
+        std::istringstream title(entry.getTitle());
+        std::string word;
+        while (title >> word) {
+          if (word.size() >= 3) {
+            sample.words.push_back(word);
+          }
+        }
+      }
+    } catch (const std::exception& e) {
+      // e.g. a ZIM file without any front article
+      std::cerr << "No request generated for '" << book.getPath() << "': " << e.what() << std::endl;
+      continue;
+    }
+    if (sample.words.empty()) {
+      sample.words.push_back(sample.name);
+    }
+    books.push_back(sample);
+  }
+
+  if (books.empty()) {
+    return {};
+  }
+
+  auto pick = [&random](const std::vector<std::string>& v) -> const std::string& {
+    return v[std::uniform_int_distribution<size_t>(0, v.size() - 1)(random)];
+  };
+  std::vector<Request> requests;
+  for (size_t i = 0; i < count; i++) {
+    const auto& kind = kinds[i % kinds.size()];
+    const auto& book = books[std::uniform_int_distribution<size_t>(0, books.size() - 1)(random)];
+    const auto& word = pick(book.words);
+    std::string url;
+    if (kind == "content") {
+      url = "/content/" + urlEncode(book.name, false) + "/" + urlEncode(pick(book.paths), true);
+    } else if (kind == "suggest") {
+      const auto prefix = word.substr(0, std::uniform_int_distribution<size_t>(1, word.size())(random));
+      url = "/suggest?content=" + urlEncode(book.name, false) + "&term=" + urlEncode(prefix, false);
+    } else if (kind == "search") {
+      url = "/search?content=" + urlEncode(book.name, false) + "&pattern=" + urlEncode(word, false);
+    } else if (kind == "catalog") {
+      url = i % 2 ? "/catalog/v2/entries?q=" + urlEncode(word, false)
+                  : "/catalog/v2/entries?start=" + std::to_string(i % library.getBookCount(true, true));
+    }
+    requests.push_back({kind, url});
+  }
+  std::shuffle(requests.begin(), requests.end(), random);
+  return requests;
+}
+
+std::vector<Request> readRequests(const std::string& path)
+{
+  std::vector<Request> requests;
+  std::ifstream in(path);
+  std::string url;
+  while (std::getline(in, url)) {
+    const auto scheme = url.find("://");
+    if (scheme != std::string::npos) {
+      url.erase(0, url.find('/', scheme + 3));
+    }
+    while (!url.empty() && isspace(static_cast<unsigned char>(url.back()))) {
+      url.pop_back();
+    }
+    if (!url.empty() && url[0] == '/') {
+      requests.push_back({"url", url});
+    }
+  }
+  return requests;
+}
+
+std::vector<Sample> runLevel(const std::vector<Request>& requests,
+                             unsigned int concurrency,
+                             size_t count,
+                             int port,
+                             double& duration)
+{
+  std::vector<Sample> samples(count);
+  std::atomic<size_t> next(0);
+  auto client = [&]() {
+    HttpClient http(port);
+    for (size_t i = next++; i < count; i = next++) {
+      const auto& request = requests[i % requests.size()];
+      const auto start = std::chrono::steady_clock::now();
+      size_t bytes = 0;
+      const auto status = http.get(request.url, bytes);
+      const std::chrono::duration<double, std::milli> latency = std::chrono::steady_clock::now() - start;
+      samples[i] = {&request, latency.count(), status >= 200 && status < 400, bytes};
+    }
+  };
+
+  const auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> clients;
+  for (unsigned int i = 0; i < concurrency; i++) {
+    clients.emplace_back(client);
+  }
+  for (auto& thread : clients) {
+    thread.join();
+  }
+  duration = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  return samples;
+}
+
+std::string latencyStats(std::vector<double> latencies)
+{
+  if (latencies.empty()) {
+    return "{}";
+  }
+  std::sort(latencies.begin(), latencies.end());
+  auto percentile = [&](double p) {
+    return latencies[std::min(latencies.size() - 1, size_t(p * latencies.size()))];
+  };
+  double sum = 0;
+  for (const auto l : latencies) {
+    sum += l;
+  }
+  std::ostringstream out;
+  out << "{\"mean\": " << sum / latencies.size()
+      << ", \"p50\": " << percentile(0.5)
+      << ", \"p99\": " << percentile(0.99)
+      << ", \"p999\": " << percentile(0.999)
+      << ", \"max\": " << latencies.back() << "}";
+  return out.str();
+}
+
+std::string levelReport(unsigned int concurrency, const std::vector<Sample>& samples, double duration)
+{
+  size_t errors = 0, bytes = 0;
+  std::vector<double> latencies;
+  std::map<std::string, std::vector<double>> kindLatencies;
+  for (const auto& sample : samples) {
+    errors += !sample.ok;
+    bytes += sample.bytes;
+    latencies.push_back(sample.latency);
+    kindLatencies[sample.request->kind].push_back(sample.latency);
+  }
+
+  std::ostringstream out;
+  out << "    {\n"
+      << "      \"concurrency\": " << concurrency << ",\n"
+      << "      \"requests\": " << samples.size() << ",\n"
+      << "      \"errors\": " << errors << ",\n"
+      << "      \"bytes\": " << bytes << ",\n"
+      << "      \"duration_s\": " << duration << ",\n"
+      << "      \"throughput_rps\": " << samples.size() / duration << ",\n"
+      << "      \"latency_ms\": " << latencyStats(latencies) << ",\n"
+      << "      \"latency_ms_by_kind\": {";
+  const char* sep = "\n";
+  for (const auto& kind : kindLatencies) {
+    out << sep << "        " << jsonString(kind.first) << ": " << latencyStats(kind.second);
+    sep = ",\n";
+  }
+  out << "\n      }\n"
+      << "    }";
+  return out.str();
+}
+
+/* Parse a comma separated list of positive integers */
+std::vector<unsigned long> parseList(const std::string& str)
+{
+  std::vector<unsigned long> values;
+  for (const auto& item : kiwix::split(str, ",")) {
+    values.push_back(std::stoul(item));
+    if (values.back() < 1) {
+      throw std::invalid_argument(item);
+    }
+  }
+  return values;
+}
+
+int main(int argc, char** argv)
+{
+  Options args;
+  try {
+    args = docopt::docopt_parse(USAGE, {argv+1, argv+argc}, false, false);
+  } catch (docopt::DocoptArgumentError const & error ) {
+    std::cerr << error.what() << std::endl;
+    std::cerr << USAGE << std::endl;
+    return -1;
+  }
+
+  if (args.at("--help").asBool()) {
+    std::cout << USAGE << std::endl;
+    return 0;
+  }
+
+  if (args.at("--version").asBool()) {
+    version();
+    return 0;
+  }
+
+  std::vector<unsigned long> concurrencies;
+  size_t requestCount;
+  unsigned int nbThreads;
+  std::mt19937 random;
+  try {
+    concurrencies = parseList(args.at("--concurrency").asString());
+    requestCount = std::stoul(args.at("--requests").asString());
+    nbThreads = std::stoul(args.at("--threads").asString());
+    random.seed(std::stoul(args.at("--seed").asString()));
+  } catch (const std::logic_error&) {
+    std::cerr << "Concurrency must be a list of positive integers, requests, threads and seed must be integers" << std::endl;
+    return -1;
+  }
+  const auto kinds = kiwix::split(args.at("--mix").asString(), ",");
+  if (kinds.empty()) {
+    std::cerr << "The mix must contain at least one kind of request" << std::endl;
+    return -1;
+  }
+  for (const auto& kind : kinds) {
+    if (kind != "content" && kind != "suggest" && kind != "search" && kind != "catalog") {
+      std::cerr << "Unknown kind of request '" << kind << "'" << std::endl;
+      return -1;
+    }
+  }
+
+  auto library = kiwix::Library::create();
+  const auto zimPaths = args.at("ZIMPATH").asStringList();
+  const auto books = loadBooks(zimPaths, nbThreads);
+  for (size_t i = 0; i < zimPaths.size(); i++) {
+    if (!books[i]) {
+      std::cerr << "Unable to open the ZIM file '" << zimPaths[i] << "'" << std::endl;
+      return 1;
+    }
+    library->addBook(*books[i]);
+  }
+  auto nameMapper = std::make_shared<kiwix::UpdatableNameMapper>(library, false);
+
+  std::vector<Request> requests;
+  if (args.at("--urls").isString()) {
+    requests = readRequests(args.at("--urls").asString());
+  } else {
+    requests = generateRequests(*library, *nameMapper, kinds, requestCount, random);
+  }
+  if (requests.empty()) {
+    std::cerr << "No request to send" << std::endl;
+    return 1;
+  }
+
+  const int port = findFreePort();
+  kiwix::Server server(library, nameMapper);
+  server.setAddress("127.0.0.1");
+  server.setPort(port);
+  server.setNbThreads(nbThreads);
+  server.setVerbose(false);
+  if (!port || !server.start()) {
+    std::cerr << "Unable to start the server" << std::endl;
+    return 1;
+  }
+
+  std::ostringstream report;
+  report << "{\n"
+         << "  \"kiwix_tools_version\": " << jsonString(KIWIX_TOOLS_VERSION) << ",\n"
+         << "  \"server_threads\": " << nbThreads << ",\n"
+         << "  \"zims\": [";
+  for (size_t i = 0; i < zimPaths.size(); i++) {
+    report << (i ? ", " : "") << jsonString(zimPaths[i]);
+  }
+  report << "],\n"
+         << "  \"results\": [\n";
+  for (size_t i = 0; i < concurrencies.size(); i++) {
+    std::cerr << "Sending " << requestCount << " requests from "
+              << concurrencies[i] << " concurrent client(s)" << std::endl;
+    double duration;
+    const auto samples = runLevel(requests, concurrencies[i], requestCount, port, duration);
+    report << (i ? ",\n" : "") << levelReport(concurrencies[i], samples, duration);
+  }
+  report << "\n  ]\n"
+         << "}\n";
+  server.stop();
+
+  if (args.at("--output").isString()) {
+    std::ofstream out(args.at("--output").asString());
+    out << report.str();
+    if (!out) {
+      std::cerr << "Cannot write the report " << args.at("--output").asString() << std::endl;
+      return 1;
+    }
+  } else {
+    std::cout << report.str();
+  }
+  return 0;
+}
@@ -0,0 +1,437 @@
+/*
+ * Copyright 2026 Kiwix <contact@kiwix.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+
+#ifndef _KIWIX_TOOLS_BINARY_LIBRARY_H_
+#define _KIWIX_TOOLS_BINARY_LIBRARY_H_
+
+#include <kiwix/library.h>
+#include <kiwix/manager.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#ifndef _WIN32
+# include <fcntl.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include <unistd.h>
+#endif
+
+/* Binary library format
+ *
+ * A binary library holds the same books as an XML library, but can be looked
+ * up without parsing all of it. Each book is stored as its own XML element,
+ * exactly as libkiwix dumps it, so that the conversion from and to the XML
+ * format is lossless (see test/library_round_trip.py) and the parsing of the
+ * books is still done by libkiwix. Two tables, sorted by book id and name, index the books.
+ *
+ * Layout (native byte order, which `byteOrder` checks):
+ *   BinaryLibraryHeader
+ *   BinaryLibraryBook[bookCount]
+ *   BinaryLibraryIndexEntry[bookCount] x 2 (by id, by name)
+ *   string data (XML prologue and epilogue, book elements and index keys)
+ */
+
+static const char BINARY_LIBRARY_MAGIC[8] = {'K', 'I', 'W', 'I', 'X', 'L', 'I', 'B'};
+static const uint32_t BINARY_LIBRARY_VERSION = 1;
+static const uint32_t BINARY_LIBRARY_BYTE_ORDER = 0x01020304;
+
+struct BinaryLibraryHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t byteOrder;
+  uint64_t bookCount;
+  uint64_t prologueOffset;
+  uint64_t prologueSize;
+  uint64_t epilogueOffset;
+  uint64_t epilogueSize;
+  uint64_t booksOffset;
+  uint64_t idIndexOffset;
+  uint64_t nameIndexOffset;
+};
+
+struct BinaryLibraryBook {
+  uint64_t xmlOffset;
+  uint64_t xmlSize;
+};
+
+struct BinaryLibraryIndexEntry {
+  uint64_t keyOffset;
+  uint32_t keySize;
+  uint32_t book;
+};
+
+namespace binary_library
+{
+
+/* Split the XML dump of a library into the text before the first book, the
+ * book elements and the text after the last book. */
+inline bool splitLibraryXml(const std::string& xml, std::string& prologue,
+                            std::vector<std::string>& books, std::string& epilogue)
+{
+  size_t pos = 0;
+  size_t end = 0;
+  while ((pos = xml.find("<book", pos)) != std::string::npos) {
+    const char next = xml[pos + 5];
+    if (next != ' ' && next != '\t' && next != '\n' && next != '/' && next != '>') {
+      pos += 5;
+      continue;
+    }
+    // Find the end of the start tag, skipping the quoted attribute values.
+    char quote = 0;
+    size_t gt = pos + 5;
+    for (; gt < xml.size(); gt++) {
+      if (quote) {
+        quote = xml[gt] == quote ? 0 : quote;
+      } else if (xml[gt] == '"' || xml[gt] == '\'') {
+        quote = xml[gt];
+      } else if (xml[gt] == '>') {
+        break;
+      }
+    }
+    if (gt >= xml.size()) {
+      return false;
+    }
+    if (xml[gt - 1] == '/') {
+      end = gt + 1;
+    } else {
+      const auto close = xml.find("</book>", gt);
+      if (close == std::string::npos) {
+        return false;
+      }
+      end = close + 7;
+    }
+    if (books.empty()) {
+      prologue = xml.substr(0, pos);
+    }
+    books.push_back(xml.substr(pos, end - pos));
+    pos = end;
+  }
+
+  if (books.empty()) {
+    prologue = xml;
+    epilogue.clear();
+  } else {
+    epilogue = xml.substr(end);
+  }
+  return true;
+}
+
+inline std::string attributeValue(const std::string& element, const std::string& name)
+{
+  const auto start = element.find(" " + name + "=\"");
+  if (start == std::string::npos) {
+    return "";
+  }
+  const auto valueStart = start + name.size() + 3;
+  return element.substr(valueStart, element.find('"', valueStart) - valueStart);
+}
+
+} // namespace binary_library
+
+/* Write `library` as a binary library at `path`. */
+inline bool writeBinaryLibrary(const kiwix::Library& library, const std::string& path)
+{
+  // Let libkiwix dump the books in the directory of the binary library, so
+  // that the relative book paths are the same.
+  const auto xmlPath = path + ".xml.tmp";
+  if (!library.writeToFile(xmlPath)) {
+    return false;
+  }
+  std::string xml;
+  {
+    std::ifstream in(xmlPath, std::ios::binary);
+    xml.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+  }
+  std::error_code ec;
+  std::filesystem::remove(xmlPath, ec);
+
+  std::string prologue, epilogue;
+  std::vector<std::string> bookXmls;
+  if (!binary_library::splitLibraryXml(xml, prologue, bookXmls, epilogue)) {
+    return false;
+  }
+
+  const uint64_t bookCount = bookXmls.size();
+  std::vector<BinaryLibraryBook> books(bookCount);
+  std::vector<BinaryLibraryIndexEntry> idIndex(bookCount), nameIndex(bookCount);
+  std::vector<std::string> ids(bookCount), names(bookCount);
+
+  std::string strings;
+  const uint64_t stringsOffset = sizeof(BinaryLibraryHeader)
+                               + bookCount * sizeof(BinaryLibraryBook)
+                               + 2 * bookCount * sizeof(BinaryLibraryIndexEntry);
+  auto addString = [&](const std::string& str) {
+    const uint64_t offset = stringsOffset + strings.size();
+    strings += str;
+    return offset;
+  };
+
+  BinaryLibraryHeader header;
+  memcpy(header.magic, BINARY_LIBRARY_MAGIC, sizeof(header.magic));
+  header.version = BINARY_LIBRARY_VERSION;
+  header.byteOrder = BINARY_LIBRARY_BYTE_ORDER;
+  header.bookCount = bookCount;
+  header.prologueOffset = addString(prologue);
+  header.prologueSize = prologue.size();
+  header.epilogueOffset = addString(epilogue);
+  header.epilogueSize = epilogue.size();
+  header.booksOffset = sizeof(BinaryLibraryHeader);
+  header.idIndexOffset = header.booksOffset + bookCount * sizeof(BinaryLibraryBook);
+  header.nameIndexOffset = header.idIndexOffset + bookCount * sizeof(BinaryLibraryIndexEntry);
+
+  for (uint32_t i = 0; i < bookCount; i++) {
+    ids[i] = binary_library::attributeValue(bookXmls[i], "id");
+    try {
+      names[i] = library.getBookById(ids[i]).getName();
+    } catch (const std::out_of_range&) {
+      return false;
+    }
+    books[i] = {addString(bookXmls[i]), bookXmls[i].size()};
+    idIndex[i] = {addString(ids[i]), uint32_t(ids[i].size()), i};
+    nameIndex[i] = {addString(names[i]), uint32_t(names[i].size()), i};
+  }
+
+  auto sortIndex = [](std::vector<BinaryLibraryIndexEntry>& index, const std::vector<std::string>& keys) {
+    std::stable_sort(index.begin(), index.end(),
+      [&](const BinaryLibraryIndexEntry& a, const BinaryLibraryIndexEntry& b) {
+        return keys[a.book] < keys[b.book];
+      });
+  };
+  sortIndex(idIndex, ids);
+  sortIndex(nameIndex, names);
+
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  out.write(reinterpret_cast<const char*>(books.data()), bookCount * sizeof(BinaryLibraryBook));
+  for (const auto* index : {&idIndex, &nameIndex}) {
+    out.write(reinterpret_cast<const char*>(index->data()), bookCount * sizeof(BinaryLibraryIndexEntry));
+  }
+  out.write(strings.data(), strings.size());
+  out.close();
+  return bool(out);
+}
+
+/* Read-only access to a binary library, mapped in memory. Only the books
+ * which are looked up or loaded are parsed. */
+class BinaryLibrary
+{
+ public:
+  /* Throws std::runtime_error if the file isn't a valid binary library */
+  explicit BinaryLibrary(const std::string& path)
+    : m_path(path)
+  {
+#ifndef _WIN32
+    const int fd = open(path.c_str(), O_RDONLY);
+    struct stat st;
+    if (fd >= 0 && fstat(fd, &st) == 0 && st.st_size > 0) {
+      void* data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (data != MAP_FAILED) {
+        m_data = static_cast<const char*>(data);
+        m_size = st.st_size;
+      }
+    }
+    if (fd >= 0) {
+      close(fd);
+    }
+#else
+    std::ifstream in(path, std::ios::binary);
+    m_buffer.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    m_data = m_buffer.data();
+    m_size = m_buffer.size();
+#endif
+    if (m_size < sizeof(BinaryLibraryHeader)) {
+      unmap();
+      throw std::runtime_error("Invalid binary library " + path);
+    }
+    memcpy(&m_header, m_data, sizeof(m_header));
+    // The strings are checked when they are read (see stringAt()), but the
+    // tables are read directly, so they must be in the file.
+    if (memcmp(m_header.magic, BINARY_LIBRARY_MAGIC, sizeof(m_header.magic)) != 0
+     || m_header.version != BINARY_LIBRARY_VERSION
+     || m_header.byteOrder != BINARY_LIBRARY_BYTE_ORDER
+     || !tableIsInFile(m_header.booksOffset, sizeof(BinaryLibraryBook))
+     || !tableIsInFile(m_header.idIndexOffset, sizeof(BinaryLibraryIndexEntry))
+     || !tableIsInFile(m_header.nameIndexOffset, sizeof(BinaryLibraryIndexEntry))) {
+      unmap();
+      throw std::runtime_error("Invalid binary library " + path);
+    }
+  }
+
+  ~BinaryLibrary()
+  {
+    unmap();
+  }
+
+  BinaryLibrary(const BinaryLibrary&) = delete;
+  BinaryLibrary& operator=(const BinaryLibrary&) = delete;
+
+  static bool isBinaryLibrary(const std::string& path)
+  {
+    char magic[sizeof(BINARY_LIBRARY_MAGIC)];
+    std::ifstream in(path, std::ios::binary);
+    return in.read(magic, sizeof(magic))
+        && memcmp(magic, BINARY_LIBRARY_MAGIC, sizeof(magic)) == 0;
+  }
+
+  uint64_t getBookCount() const { return m_header.bookCount; }
+
+  std::optional<uint32_t> findById(const std::string& id) const
+  {
+    const auto books = find(m_header.idIndexOffset, id);
+    return books.empty() ? std::nullopt : std::optional<uint32_t>(books.front());
+  }
+
+  std::vector<uint32_t> findByName(const std::string& name) const
+  {
+    return find(m_header.nameIndexOffset, name);
+  }
+
+  /* Add the given books to `library`, parsing only their XML elements. */
+  bool addBooks(kiwix::LibraryPtr library, const std::vector<uint32_t>& books) const
+  {
+    std::string xml(stringAt(m_header.prologueOffset, m_header.prologueSize));
+    for (const auto book : books) {
+      if (book >= m_header.bookCount) {
+        return false;
+      }
+      BinaryLibraryBook record;
+      memcpy(&record, m_data + m_header.booksOffset + book * sizeof(record), sizeof(record));
+      xml += stringAt(record.xmlOffset, record.xmlSize);
+    }
+    xml += stringAt(m_header.epilogueOffset, m_header.epilogueSize);
+    kiwix::Manager manager(library);
+    return manager.readXml(xml, false, m_path, true);
+  }
+
+  bool addAllBooks(kiwix::LibraryPtr library) const
+  {
+    std::vector<uint32_t> books(m_header.bookCount);
+    for (uint32_t i = 0; i < books.size(); i++) {
+      books[i] = i;
+    }
+    return addBooks(library, books);
+  }
+
+ private:
+  /* Whether a table of `bookCount` entries at `offset` is in the file,
+   * without overflowing */
+  bool tableIsInFile(uint64_t offset, uint64_t entrySize) const
+  {
+    return offset >= sizeof(BinaryLibraryHeader)
+        && offset <= m_size
+        && m_header.bookCount <= (m_size - offset) / entrySize;
+  }
+
+  /* Throws std::runtime_error if the string is not in the file */
+  std::string_view stringAt(uint64_t offset, uint64_t size) const
+  {
+    if (offset > m_size || size > m_size - offset) {
+      throw std::runtime_error("Invalid binary library " + m_path);
+    }
+    return std::string_view(m_data + offset, size);
+  }
+
+  BinaryLibraryIndexEntry indexEntry(uint64_t indexOffset, uint64_t i) const
+  {
+    BinaryLibraryIndexEntry entry;
+    memcpy(&entry, m_data + indexOffset + i * sizeof(entry), sizeof(entry));
+    return entry;
+  }
+
+  /* Binary search of `key` in a sorted index */
+  std::vector<uint32_t> find(uint64_t indexOffset, const std::string& key) const
+  {
+    auto keyAt = [&](uint64_t i) {
+      const auto entry = indexEntry(indexOffset, i);
+      return stringAt(entry.keyOffset, entry.keySize);
+    };
+    uint64_t low = 0, high = m_header.bookCount;
+    while (low < high) {
+      const uint64_t middle = low + (high - low) / 2;
+      if (keyAt(middle) < key) {
+        low = middle + 1;
+      } else {
+        high = middle;
+      }
+    }
+    std::vector<uint32_t> books;
+    for (; low < m_header.bookCount && keyAt(low) == key; low++) {
+      books.push_back(indexEntry(indexOffset, low).book);
+    }
+    return books;
+  }
+
+  void unmap()
+  {
+#ifndef _WIN32
+    if (m_data) {
+      munmap(const_cast<char*>(m_data), m_size);
+    }
+#endif
+    m_data = nullptr;
+    m_size = 0;
+  }
+
+  std::string m_path;
+  const char* m_data = nullptr;
+  size_t m_size = 0;
+#ifdef _WIN32
+  std::string m_buffer;
+#endif
+  BinaryLibraryHeader m_header;
+};
+
+/* Read a binary library into `library`: only the books of `bookIds` if it is
+ * not empty, otherwise only the books named `bookName` if it is not empty,
+ * otherwise all the books. Unknown ids and names are ignored. */
+inline bool readBinaryLibrary(kiwix::LibraryPtr library, const std::string& path,
+                              const std::vector<std::string>& bookIds = {},
+                              const std::string& bookName = "")
+{
+  try {
+    BinaryLibrary binaryLibrary(path);
+    if (!bookIds.empty()) {
+      std::vector<uint32_t> books;
+      for (const auto& id : bookIds) {
+        if (const auto book = binaryLibrary.findById(id)) {
+          books.push_back(*book);
+        }
+      }
+      return binaryLibrary.addBooks(library, books);
+    }
+    if (!bookName.empty()) {
+      return binaryLibrary.addBooks(library, binaryLibrary.findByName(bookName));
+    }
+    return binaryLibrary.addAllBooks(library);
+  } catch (const std::runtime_error&) {
+    return false;
+  }
+}
+
+#endif //_KIWIX_TOOLS_BINARY_LIBRARY_H_
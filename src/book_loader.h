@@ -0,0 +1,90 @@
+/*
+ * Copyright 2026 Kiwix <contact@kiwix.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+
+#ifndef _KIWIX_TOOLS_BOOK_LOADER_H_
+#define _KIWIX_TOOLS_BOOK_LOADER_H_
+
+#include <kiwix/book.h>
+#include <kiwix/tools.h>
+#include <zim/archive.h>
+
+#include <algorithm>
+#include <atomic>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+typedef std::vector<std::optional<kiwix::Book>> LoadedBooks;
+
+/* Open a ZIM file and build the corresponding book, the same way
+ * kiwix::Manager::addBookFromPath() does. Returns an empty optional if the
+ * ZIM file can't be opened. */
+inline std::optional<kiwix::Book> loadBook(const std::string& zimPath)
+{
+  try {
+    kiwix::Book book;
+    book.update(zim::Archive(zimPath));
+    book.setPath(kiwix::isRelativePath(zimPath)
+                   ? kiwix::computeAbsolutePath(kiwix::getCurrentDirectory(), zimPath)
+                   : zimPath);
+    book.setPathValid(true);
+    return book;
+  } catch (...) {
+    return std::nullopt;
+  }
+}
+
+/* Call `task(i)` for each i in [0, count[ on (at most) `nbThreads` threads,
+ * the calling one included. */
+template<typename Task>
+void runInParallel(size_t count, unsigned int nbThreads, Task task)
+{
+  std::atomic<size_t> next(0);
+  auto worker = [&]() {
+    for (size_t i = next++; i < count; i = next++) {
+      task(i);
+    }
+  };
+
+  nbThreads = std::max(1U, std::min<unsigned int>(nbThreads, count));
+  std::vector<std::thread> threads;
+  for (unsigned int i = 1; i < nbThreads; i++) {
+    threads.emplace_back(worker);
+  }
+  worker();
+  for (auto& thread : threads) {
+    thread.join();
+  }
+}
+
+/* Open the ZIM files on (at most) `nbThreads` worker threads.
+ * The result has one slot per path, in the order of `zimPaths`, so that the
+ * caller can add the books to the library in a deterministic order. */
+inline LoadedBooks loadBooks(const std::vector<std::string>& zimPaths,
+                             unsigned int nbThreads)
+{
+  LoadedBooks books(zimPaths.size());
+  runInParallel(zimPaths.size(), nbThreads, [&](size_t i) {
+    books[i] = loadBook(zimPaths[i]);
+  });
+  return books;
+}
+
+#endif //_KIWIX_TOOLS_BOOK_LOADER_H_
@@ -0,0 +1,114 @@
+/*
+ * Copyright 2026 Kiwix <contact@kiwix.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+
+#ifndef _KIWIX_TOOLS_CACHE_DIR_H_
+#define _KIWIX_TOOLS_CACHE_DIR_H_
+
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#ifndef _WIN32
+# include <sys/stat.h>
+# include <unistd.h>
+#endif
+
+/* Create `dir` if needed and check that files can be written in it */
+inline bool isWritableDir(const std::filesystem::path& dir)
+{
+  std::error_code ec;
+  std::filesystem::create_directories(dir, ec);
+  if (ec) {
+    return false;
+  }
+  const auto testPath = dir / ".kiwix_write_test";
+  const bool writable = bool(std::ofstream(testPath));
+  std::filesystem::remove(testPath, ec);
+  return writable;
+}
+
+/* Per-user directory in the shared temporary directory `tmpDir`, or an empty
+ * path if it can't be used safely.
+ * On POSIX systems, the directory is named after the uid and created with
+ * mode 0700. It is refused if it is not a real directory owned by the current
+ * user, since anybody could have created it beforehand. */
+inline std::filesystem::path getPrivateTmpDir(const std::filesystem::path& tmpDir)
+{
+#ifdef _WIN32
+  // The temporary directory is already per-user
+  return tmpDir / "kiwix";
+#else
+  const auto dir = tmpDir / ("kiwix-" + std::to_string(getuid()));
+  mkdir(dir.c_str(), 0700);
+  struct stat info;
+  if (lstat(dir.c_str(), &info) != 0 || !S_ISDIR(info.st_mode) || info.st_uid != getuid()) {
+    return std::filesystem::path();
+  }
+  if ((info.st_mode & 0777) != 0700 && chmod(dir.c_str(), 0700) != 0) {
+    return std::filesystem::path();
+  }
+  return dir;
+#endif
+}
+
+/* Directory where the data computed from the ZIM files (like the spellings
+ * databases) is cached and shared between the tools.
+ * Use `customDir` if not empty, otherwise the first writable directory among
+ * $XDG_CACHE_HOME/kiwix, $HOME/.cache/kiwix and a private directory of the
+ * current user in the temporary directory (see getPrivateTmpDir()), so that
+ * the tools keep working in containers where $HOME is unset or read-only. */
+inline std::filesystem::path getKiwixCacheDir(const std::string& customDir = "")
+{
+  if (!customDir.empty()) {
+    if (!isWritableDir(customDir)) {
+      throw std::runtime_error("Cannot write in the cache directory " + customDir);
+    }
+    return customDir;
+  }
+
+  std::vector<std::filesystem::path> candidates;
+  const char* xdgCacheHome = getenv("XDG_CACHE_HOME");
+  if (xdgCacheHome && *xdgCacheHome) {
+    candidates.push_back(std::filesystem::path(xdgCacheHome) / "kiwix");
+  }
+  const char* home = getenv("HOME");
+  if (home && *home) {
+    candidates.push_back(std::filesystem::path(home) / ".cache" / "kiwix");
+  }
+  std::error_code ec;
+  const auto tmpDir = std::filesystem::temp_directory_path(ec);
+  if (!ec) {
+    const auto privateTmpDir = getPrivateTmpDir(tmpDir);
+    if (!privateTmpDir.empty()) {
+      candidates.push_back(privateTmpDir);
+    }
+  }
+
+  for (const auto& candidate : candidates) {
+    if (isWritableDir(candidate)) {
+      return candidate;
+    }
+  }
+  throw std::runtime_error("Cannot find a writable cache directory");
+}
+
+#endif //_KIWIX_TOOLS_CACHE_DIR_H_
@@ -19,36 +19,123 @@
 
 #include <docopt/docopt.h>
 #include <kiwix/manager.h>
+#include <kiwix/spelling_correction.h>
 #include <kiwix/tools.h>
+#include <zim/archive.h>
+#include <xapian.h>
+#include <algorithm>
+#include <atomic>
 #include <cstdlib>
+#include <cstring>
+#include <filesystem>
 #include <iostream>
-
+#include <limits>
+#include <map>
+#include <mutex>
+#include <set>
+
+#ifndef _WIN32
+# include <glob.h>
+#endif
+
+#include "../binary_library.h"
+#include "../book_loader.h"
+#include "../cache_dir.h"
+#include "../json.h"
 #include "../version.h"
 
 using namespace std;
 
-enum supportedAction { NONE, ADD, SHOW, REMOVE };
+enum supportedAction { NONE, ADD, SHOW, REMOVE, SPELLINGS, CONVERT, VERIFY };
+
+enum class ShowFormat { TEXT, JSON, CSV };
+
+struct BookField {
+  const char* name;
+  bool isNumber;
+  std::string (*get)(const kiwix::Book& book);
+};
+
+static const BookField BOOK_FIELDS[] = {
+  {"id", false, [](const kiwix::Book& b) { return b.getId(); }},
+  {"path", false, [](const kiwix::Book& b) { return b.getPath(); }},
+  {"url", false, [](const kiwix::Book& b) { return b.getUrl(); }},
+  {"title", false, [](const kiwix::Book& b) { return b.getTitle(); }},
+  {"name", false, [](const kiwix::Book& b) { return b.getName(); }},
+  {"tags", false, [](const kiwix::Book& b) { return b.getTags(); }},
+  {"description", false, [](const kiwix::Book& b) { return b.getDescription(); }},
+  {"creator", false, [](const kiwix::Book& b) { return b.getCreator(); }},
+  {"date", false, [](const kiwix::Book& b) { return b.getDate(); }},
+  {"articleCount", true, [](const kiwix::Book& b) { return std::to_string(b.getArticleCount()); }},
+  {"mediaCount", true, [](const kiwix::Book& b) { return std::to_string(b.getMediaCount()); }},
+  {"size", true, [](const kiwix::Book& b) { return std::to_string(b.getSize()); }},
+  {"publisher", false, [](const kiwix::Book& b) { return b.getPublisher(); }},
+  {"language", false, [](const kiwix::Book& b) { return b.getCommaSeparatedLanguages(); }},
+  {"category", false, [](const kiwix::Book& b) { return b.getCategory(); }},
+  {"flavour", false, [](const kiwix::Book& b) { return b.getFlavour(); }}
+};
+
+/* The fields historically shown by the text format */
+static const char DEFAULT_TEXT_FIELDS[] = "id,path,url,title,name,tags,description,creator,date,articleCount,mediaCount,size";
+
+typedef std::vector<const BookField*> BookFields;
+
+bool parseBookFields(const std::string& names, BookFields& fields)
+{
+  for (const auto& name : kiwix::split(names, ",")) {
+    const auto it = std::find_if(std::begin(BOOK_FIELDS), std::end(BOOK_FIELDS),
+                                 [&](const BookField& field) { return name == field.name; });
+    if (it == std::end(BOOK_FIELDS)) {
+      return false;
+    }
+    fields.push_back(&*it);
+  }
+  return !fields.empty();
+}
 
-void show(const kiwix::Library& library, const std::string& bookId)
+std::string csvValue(const std::string& value)
 {
-  try {
-    auto& book = library.getBookById(bookId);
-    std::cout << "id:\t\t" << book.getId() << std::endl
-              << "path:\t\t" << book.getPath() << std::endl
-              << "url:\t\t" << book.getUrl() << std::endl
-              << "title:\t\t" << book.getTitle() << std::endl
-              << "name:\t\t" << book.getName() << std::endl
-              << "tags:\t\t" << book.getTags() << std::endl
-              << "description:\t" << book.getDescription() << std::endl
-              << "creator:\t" << book.getCreator() << std::endl
-              << "date:\t\t" << book.getDate() << std::endl
-              << "articleCount:\t" << book.getArticleCount() << std::endl
-              << "mediaCount:\t" << book.getMediaCount() << std::endl
-              << "size:\t\t" << book.getSize() << " KB" << std::endl;
-  } catch (std::out_of_range&) {
-     std::cout << "No book " << bookId << " in the library" << std::endl;
-  }
-  std::cout << std::endl;
+  if (value.find_first_of(",\"\r\n") == std::string::npos) {
+    return value;
+  }
+  std::string quoted = "\"";
+  for (const char c : value) {
+    quoted += c;
+    if (c == '"') {
+      quoted += c;
+    }
+  }
+  return quoted + "\"";
+}
+
+void show(std::ostream& out, const kiwix::Book& book, const BookFields& fields,
+          ShowFormat format, bool first)
+{
+  switch (format) {
+    case ShowFormat::TEXT:
+      for (const auto field : fields) {
+        const std::string label = std::string(field->name) + ":";
+        out << label << (label.size() < 8 ? "\t\t" : "\t") << field->get(book)
+            << (strcmp(field->name, "size") == 0 ? " KB" : "") << '\n';
+      }
+      out << '\n';
+      break;
+    case ShowFormat::JSON:
+      out << (first ? "\n  {" : ",\n  {");
+      for (size_t i = 0; i < fields.size(); i++) {
+        const auto value = fields[i]->get(book);
+        out << (i ? ", " : "") << jsonString(fields[i]->name) << ": "
+            << (fields[i]->isNumber ? value : jsonString(value));
+      }
+      out << "}";
+      break;
+    case ShowFormat::CSV:
+      for (size_t i = 0; i < fields.size(); i++) {
+        out << (i ? "," : "") << csvValue(fields[i]->get(book));
+      }
+      out << '\n';
+      break;
+  }
 }
 
 // Older version of docopt doesn't declare Options. Let's declare it ourself.
@@ -57,24 +144,57 @@ using Options = std::map<std::string, docopt::value>;
 
 /* Print correct console usage options */
 static const char USAGE[] =
-R"(Manipulates the Kiwix library XML file
+R"(Manipulates the Kiwix library XML (or binary) file
 
 Usage:
- kiwix-manage LIBRARYPATH add [--zimPathToSave=<custom_zim_path>] [--url=<http_zim_url>] ZIMPATH ...
+ kiwix-manage LIBRARYPATH add [--zimPathToSave=<custom_zim_path>] [--url=<http_zim_url>] [--skipInvalid] [--threads=<threads>] ZIMPATH ...
  kiwix-manage LIBRARYPATH (delete|remove) ZIMID ...
- kiwix-manage LIBRARYPATH show [ZIMID ...]
+ kiwix-manage LIBRARYPATH show [--format=<format>] [--fields=<fields>] [--lang=<lang>] [--tags=<tags>] [--category=<category>] [--creator=<creator>] [--publisher=<publisher>] [--name=<name>] [--query=<query>] [--maxSize=<bytes>] [--sort=<field>] [--reverse] [ZIMID ...]
+ kiwix-manage LIBRARYPATH spellings [--cacheDir=<dir>] [--threads=<threads>] [ZIMID ...]
+ kiwix-manage LIBRARYPATH convert [--binary] OUTPUTPATH
+ kiwix-manage LIBRARYPATH verify [--fix] [--integrity] [--ioBudget=<MB>] [--threads=<threads>] [ZIMID ...]
  kiwix-manage -v | --version
  kiwix-manage -h | --help
 
 Arguments:
-  LIBRARYPATH    The XML library file path.
+  LIBRARYPATH    The XML or binary library file path.
+  OUTPUTPATH     The path of the converted library file.
   ZIMID          ZIM file unique ID.
-  ZIMPATH        A path to a ZIM to add.
+  ZIMPATH        A path to a ZIM to add, a directory containing ZIM files, a glob pattern or "-" to read the paths from STDIN.
 
 Options:
   Custom options for "add" action:
     --zimPathToSave=<custom_zim_path>  Replace the current ZIM file path
     --url=<http_zim_url>               Create an "url" attribute for the online version of the ZIM file
+    --skipInvalid                      Report the ZIM files which can't be opened and add the other ones, instead of failing
+
+  Custom options for "show" action:
+    --format=<format>                  Output format: text, json or csv [default: text]
+    --fields=<fields>                  Comma separated fields to show, among id, path, url, title, name, tags, description, creator, date, articleCount, mediaCount, size, publisher, language, category and flavour (default: all of them, or the historical ones in text format)
+    --lang=<lang>                      Only show the books in this language
+    --tags=<tags>                      Only show the books having all these comma separated tags
+    --category=<category>              Only show the books of this category
+    --creator=<creator>                Only show the books of this creator
+    --publisher=<publisher>            Only show the books of this publisher
+    --name=<name>                      Only show the books with this name
+    --query=<query>                    Only show the books matching this full text query on their title and description
+    --maxSize=<bytes>                  Only show the books smaller than this size
+    --sort=<field>                     Sort the books by title, name, size, date, creator or publisher
+    --reverse                          Sort the books in descending order
+
+  Custom options for "spellings" action:
+    --cacheDir=<dir>                   Directory of the spellings databases (default: $XDG_CACHE_HOME/kiwix, $HOME/.cache/kiwix or $TMPDIR/kiwix-<uid>)
+
+  Custom options for "convert" action:
+    --binary                           Write a binary library, indexed by book id and name, instead of an XML one
+
+  Custom options for "verify" action:
+    --fix                              Remove the missing and invalid books from the library and update the outdated ones
+    --integrity                        Also run the integrity checks of libzim on the ZIM files
+    --ioBudget=<MB>                    Maximal size of the ZIM files read entirely to verify their checksum (0 means no limit) [default: 0]
+
+  Custom options for "add", "spellings" and "verify" actions:
+    --threads=<threads>                Number of ZIM files processed in parallel [default: 4]
 
   Other options:
     -h --help                          Print this help
@@ -82,8 +202,13 @@ Options:
 
 Examples:
  Add ZIM files to library:       kiwix-manage my_library.xml add first.zim second.zim
+ Add a directory of ZIM files:   kiwix-manage my_library.xml add --skipInvalid /srv/zims
  Remove ZIM files from library:  kiwix-manage my_library.xml remove e5c2c003-b49e-2756-5176-5d9c86393dd9
  Show all library ZIM files:     kiwix-manage my_library.xml show
+ List the English books as CSV:  kiwix-manage my_library.xml show --format=csv --fields=id,name,size --lang=eng --sort=size
+ Build the spellings databases:  kiwix-manage my_library.xml spellings --cacheDir=/var/cache/kiwix
+ Convert to a binary library:    kiwix-manage my_library.xml convert --binary my_library.kwl
+ Check the library ZIM files:    kiwix-manage my_library.xml verify --integrity --ioBudget=10000
 
 Documentation:
   Source code  https://github.com/kiwix/kiwix-tools
@@ -93,46 +218,256 @@ Documentation:
 int handle_show(const kiwix::Library& library, const std::string& libraryPath,
                  const Options& options)
 {
-  if (options.at("ZIMID").asStringList().empty()) {
-    auto booksIds = library.getBooksIds();
-    for(auto& bookId: booksIds) {
-      show(library, bookId);
-    }
+  ShowFormat format;
+  const auto formatName = options.at("--format").asString();
+  if (formatName == "text") {
+    format = ShowFormat::TEXT;
+  } else if (formatName == "json") {
+    format = ShowFormat::JSON;
+  } else if (formatName == "csv") {
+    format = ShowFormat::CSV;
   } else {
-    auto bookIds = options.at("ZIMID").asStringList();
-    for(auto& bookId: bookIds) {
-       show(library, bookId);
+    std::cerr << "Unknown format '" << formatName << "'" << std::endl;
+    return 1;
+  }
+
+  BookFields fields;
+  std::string fieldNames = DEFAULT_TEXT_FIELDS;
+  if (options.at("--fields").isString()) {
+    fieldNames = options.at("--fields").asString();
+  } else if (format != ShowFormat::TEXT) {
+    fieldNames.clear();
+    for (const auto& field : BOOK_FIELDS) {
+      fieldNames += std::string(fieldNames.empty() ? "" : ",") + field.name;
+    }
+  }
+  if (!parseBookFields(fieldNames, fields)) {
+    std::cerr << "Invalid fields '" << fieldNames << "'" << std::endl;
+    return 1;
+  }
+
+  /* Let the library select and sort the books */
+  kiwix::Filter filter;
+  if (options.at("--lang").isString()) {
+    filter.lang(options.at("--lang").asString());
+  }
+  if (options.at("--tags").isString()) {
+    filter.acceptTags(kiwix::split(options.at("--tags").asString(), ","));
+  }
+  if (options.at("--category").isString()) {
+    filter.category(options.at("--category").asString());
+  }
+  if (options.at("--creator").isString()) {
+    filter.creator(options.at("--creator").asString());
+  }
+  if (options.at("--publisher").isString()) {
+    filter.publisher(options.at("--publisher").asString());
+  }
+  if (options.at("--name").isString()) {
+    filter.name(options.at("--name").asString());
+  }
+  if (options.at("--query").isString()) {
+    filter.query(options.at("--query").asString());
+  }
+  if (options.at("--maxSize").isString()) {
+    try {
+      filter.maxSize(std::stoull(options.at("--maxSize").asString()));
+    } catch (const std::logic_error&) {
+      std::cerr << "Maximal size must be an integer" << std::endl;
+      return 1;
+    }
+  }
+  auto bookIds = library.filter(filter);
+
+  if (options.at("--sort").isString()) {
+    static const std::map<std::string, kiwix::supportedListSortBy> sortFields = {
+      {"title", kiwix::TITLE},
+      {"size", kiwix::SIZE},
+      {"date", kiwix::DATE},
+      {"creator", kiwix::CREATOR},
+      {"publisher", kiwix::PUBLISHER}
+    };
+    const auto sortField = options.at("--sort").asString();
+    const bool ascending = !options.at("--reverse").asBool();
+    const auto it = sortFields.find(sortField);
+    if (it != sortFields.end()) {
+      library.sort(bookIds, it->second, ascending);
+    } else if (sortField == "name") {
+      // libkiwix can't sort by name
+      std::stable_sort(bookIds.begin(), bookIds.end(), [&](const std::string& a, const std::string& b) {
+        const auto& nameA = library.getBookById(a).getName();
+        const auto& nameB = library.getBookById(b).getName();
+        return ascending ? nameA < nameB : nameB < nameA;
+      });
+    } else {
+      std::cerr << "Cannot sort the books by '" << sortField << "'" << std::endl;
+      return 1;
+    }
+  }
+
+  // Show the given books in the given order, if they match the filters.
+  const auto requestedIds = options.at("ZIMID").asStringList();
+  if (!requestedIds.empty()) {
+    const std::set<std::string> selectedIds(bookIds.begin(), bookIds.end());
+    bookIds.clear();
+    for (const auto& id : requestedIds) {
+      if (selectedIds.count(id)) {
+        bookIds.push_back(id);
+      } else {
+        try {
+          library.getBookById(id);
+        } catch (std::out_of_range&) {
+          if (format == ShowFormat::TEXT) {
+            std::cout << "No book " << id << " in the library" << "\n\n";
+          } else {
+            std::cerr << "No book " << id << " in the library" << std::endl;
+          }
+        }
+      }
     }
   }
 
+  // Many books are shown, don't flush the output after each line.
+  if (format == ShowFormat::JSON) {
+    std::cout << "[";
+  } else if (format == ShowFormat::CSV) {
+    for (size_t i = 0; i < fields.size(); i++) {
+      std::cout << (i ? "," : "") << fields[i]->name;
+    }
+    std::cout << '\n';
+  }
+  bool first = true;
+  for (const auto& id : bookIds) {
+    show(std::cout, library.getBookById(id), fields, format, first);
+    first = false;
+  }
+  if (format == ShowFormat::JSON) {
+    std::cout << (first ? "]\n" : "\n]\n");
+  }
+  std::cout << std::flush;
+
   return(0);
 }
 
+bool getNbThreads(const Options& options, unsigned int& nbThreads)
+{
+  try {
+    nbThreads = std::stoul(options.at("--threads").asString());
+    return true;
+  } catch (const std::logic_error&) {
+    std::cerr << "Number of threads must be an integer" << std::endl;
+    return false;
+  }
+}
+
+bool isGlobPattern(const std::string& path)
+{
+  return path.find_first_of("*?[") != std::string::npos;
+}
+
+/* Expand the ZIMPATH arguments of the "add" action: a directory stands for the
+ * ZIM files it contains (recursively), a glob pattern for the files it matches
+ * and "-" for the paths read from STDIN, one per line.
+ * Returns the number of arguments which can't be (fully) expanded, which are
+ * reported. */
+unsigned int expandZimPaths(const std::vector<std::string>& args,
+                            std::vector<std::string>& zimPaths)
+{
+  unsigned int errorCount = 0;
+  for (const auto& arg : args) {
+    if (arg == "-") {
+      std::string line;
+      while (std::getline(std::cin, line)) {
+        if (!line.empty()) {
+          zimPaths.push_back(line);
+        }
+      }
+    } else if (std::filesystem::is_directory(arg)) {
+      std::vector<std::string> dirZimPaths;
+      std::error_code ec;
+      const auto opts = std::filesystem::directory_options::skip_permission_denied;
+      for (std::filesystem::recursive_directory_iterator it(arg, opts, ec), end; !ec && it != end; it.increment(ec)) {
+        // An entry which can't be inspected (e.g. a dangling symlink) is
+        // skipped, without stopping the walk.
+        std::error_code entryEc;
+        if (it->path().extension() == ".zim" && it->is_regular_file(entryEc)) {
+          dirZimPaths.push_back(it->path().string());
+        }
+      }
+      if (ec) {
+        std::cerr << "Error while reading the directory " << arg << ": " << ec.message() << std::endl;
+        errorCount++;
+      } else if (dirZimPaths.empty()) {
+        std::cerr << "No ZIM file found in the directory " << arg << std::endl;
+        errorCount++;
+      }
+      std::sort(dirZimPaths.begin(), dirZimPaths.end());
+      zimPaths.insert(zimPaths.end(), dirZimPaths.begin(), dirZimPaths.end());
+#ifndef _WIN32
+    } else if (isGlobPattern(arg) && !kiwix::fileExists(arg)) {
+      glob_t matches;
+      if (glob(arg.c_str(), 0, nullptr, &matches) == 0) {
+        for (size_t i = 0; i < matches.gl_pathc; i++) {
+          zimPaths.push_back(matches.gl_pathv[i]);
+        }
+      } else {
+        std::cerr << "No file matches " << arg << std::endl;
+        errorCount++;
+      }
+      globfree(&matches);
+#endif
+    } else {
+      zimPaths.push_back(arg);
+    }
+  }
+  return errorCount;
+}
+
 int handle_add(kiwix::LibraryPtr library, const std::string& libraryPath,
                 const Options& options)
 {
-  string zimPathToSave;
-  string url;
+  unsigned int nbThreads;
+  if (!getNbThreads(options, nbThreads)) {
+    return 1;
+  }
+  const bool skipInvalid = options.at("--skipInvalid").asBool();
+
+  std::vector<std::string> zimPaths;
+  unsigned int invalidCount = expandZimPaths(options.at("ZIMPATH").asStringList(), zimPaths);
+  const auto books = loadBooks(zimPaths, nbThreads);
+
+  std::map<std::string, std::string> addedBookPaths;
+  for (size_t i = 0; i < zimPaths.size(); i++) {
+    if (!books[i]) {
+      std::cerr << "Cannot add ZIM " << zimPaths[i] << " to the library." << std::endl;
+      invalidCount++;
+      continue;
+    }
 
-  kiwix::Manager manager(library);
+    auto book = *books[i];
+    const auto added = addedBookPaths.emplace(book.getId(), zimPaths[i]);
+    if (!added.second) {
+      std::cerr << "Skipping ZIM " << zimPaths[i] << ", it is the same book as "
+                << added.first->second << "." << std::endl;
+      continue;
+    }
 
-  auto zimPaths = options.at("ZIMPATH").asStringList();
-  for (auto& zimPath: zimPaths) {
     if (options.at("--zimPathToSave").isString()) {
-      zimPathToSave = options.at("--zimPathToSave").asString();
-    } else {
-      zimPathToSave = zimPath;
+      /* Relative to the library file, as kiwix::Manager does */
+      const auto zimPathToSave = options.at("--zimPathToSave").asString();
+      book.setPath(kiwix::isRelativePath(zimPathToSave)
+                     ? kiwix::computeAbsolutePath(kiwix::removeLastPathElement(libraryPath), zimPathToSave)
+                     : zimPathToSave);
     }
     if (options.at("--url").isString()) {
-      url = options.at("--url").asString();
-    }
-
-    if (manager.addBookFromPathAndGetId(zimPath, zimPathToSave, url, false).empty()) {
-      std::cerr << "Cannot add ZIM " << zimPath << " to the library." << std::endl;
-      return 1;
+      book.setUrl(options.at("--url").asString());
     }
+    library->addBook(book);
   }
 
+  if (invalidCount && !skipInvalid) {
+    return 1;
+  }
   return 0;
 }
 
@@ -159,6 +494,268 @@ int handle_remove(kiwix::Library& library, const std::string& libraryPath,
   return(exitCode);
 }
 
+int handle_spellings(const kiwix::Library& library, const std::string& libraryPath,
+                     const Options& options)
+{
+  unsigned int nbThreads;
+  if (!getNbThreads(options, nbThreads)) {
+    return 1;
+  }
+
+  std::filesystem::path cacheDir;
+  try {
+    cacheDir = getKiwixCacheDir(options.at("--cacheDir").isString() ? options.at("--cacheDir").asString() : "");
+  } catch (const std::runtime_error& e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+
+  auto bookIds = options.at("ZIMID").asStringList();
+  if (bookIds.empty()) {
+    bookIds = library.filter(kiwix::Filter().local(true).valid(true));
+  }
+
+  // The databases are named after the archive UUID, so a rebuilt ZIM file
+  // gets a new database and an up to date one is reused as is.
+  std::mutex outputMutex;
+  int exitCode = 0;
+  runInParallel(bookIds.size(), nbThreads, [&](size_t i) {
+    std::string error;
+    try {
+      const auto book = library.getBookByIdThreadSafe(bookIds[i]);
+      zim::Archive archive(book.getPath());
+      kiwix::SpellingsDB spellingsDB(archive, cacheDir);
+    } catch (const std::out_of_range&) {
+      error = "invalid book id";
+    } catch (const Xapian::Error& e) {
+      error = e.get_msg();
+    } catch (const std::exception& e) {
+      error = e.what();
+    }
+
+    std::lock_guard<std::mutex> lock(outputMutex);
+    if (error.empty()) {
+      std::cout << "Spellings database of " << bookIds[i] << " is ready" << std::endl;
+    } else {
+      std::cerr << "Cannot build the spellings database of " << bookIds[i]
+                << ": " << error << std::endl;
+      exitCode = 1;
+    }
+  });
+  return exitCode;
+}
+
+enum class BookStatus { OK, MISSING, INVALID, CORRUPTED, OUTDATED };
+
+struct BookCheck {
+  BookStatus status = BookStatus::OK;
+  std::string message;
+  std::optional<kiwix::Book> updatedBook;
+};
+
+std::string integrityCheckName(zim::IntegrityCheck checkType)
+{
+  switch (checkType) {
+    case zim::IntegrityCheck::CHECKSUM: return "checksum";
+    case zim::IntegrityCheck::DIRENT_PTRS: return "dirent pointers";
+    case zim::IntegrityCheck::DIRENT_ORDER: return "dirent order";
+    case zim::IntegrityCheck::TITLE_INDEX: return "title index";
+    case zim::IntegrityCheck::CLUSTER_PTRS: return "cluster pointers";
+    case zim::IntegrityCheck::DIRENT_MIMETYPES: return "dirent mimetypes";
+    default: return "#" + std::to_string(int(checkType));
+  }
+}
+
+BookCheck checkBook(const kiwix::Book& book, bool integrity,
+                    std::atomic<int64_t>& ioBudget)
+{
+  BookCheck check;
+  if (!kiwix::fileExists(book.getPath())) {
+    check.status = BookStatus::MISSING;
+    check.message = "ZIM file " + book.getPath() + " is missing";
+    return check;
+  }
+
+  auto currentBook = loadBook(book.getPath());
+  if (!currentBook) {
+    check.status = BookStatus::INVALID;
+    check.message = "ZIM file " + book.getPath() + " cannot be opened";
+    return check;
+  }
+
+  if (integrity) {
+    try {
+      zim::Archive archive(book.getPath());
+      for (int i = 0; i < int(zim::IntegrityCheck::COUNT); i++) {
+        const auto checkType = zim::IntegrityCheck(i);
+        if (checkType == zim::IntegrityCheck::CHECKSUM) {
+          // Verifying the checksum reads the whole file, do it only if the
+          // I/O budget allows it.
+          const int64_t size = archive.getFilesize();
+          if (ioBudget.fetch_sub(size) < size) {
+            ioBudget += size;
+            continue;
+          }
+        }
+        if (!archive.checkIntegrity(checkType)) {
+          check.status = BookStatus::CORRUPTED;
+          check.message = "ZIM file " + book.getPath() + " failed the " + integrityCheckName(checkType) + " check";
+          return check;
+        }
+      }
+    } catch (const std::exception& e) {
+      check.status = BookStatus::CORRUPTED;
+      check.message = "ZIM file " + book.getPath() + " failed the integrity checks: " + e.what();
+      return check;
+    }
+  }
+
+  if (currentBook->getId() != book.getId()
+   || currentBook->getArticleCount() != book.getArticleCount()
+   || currentBook->getMediaCount() != book.getMediaCount()
+   || currentBook->getSize() != book.getSize()) {
+    check.status = BookStatus::OUTDATED;
+    check.message = "ZIM file " + book.getPath() + " changed (now book " + currentBook->getId()
+                  + ", " + std::to_string(currentBook->getArticleCount()) + " articles, "
+                  + std::to_string(currentBook->getSize()) + " bytes)";
+    currentBook->setPath(book.getPath());
+    currentBook->setUrl(book.getUrl());
+    check.updatedBook = currentBook;
+  }
+  return check;
+}
+
+int handle_verify(kiwix::LibraryPtr library, const std::string& libraryPath,
+                  const Options& options)
+{
+  unsigned int nbThreads;
+  if (!getNbThreads(options, nbThreads)) {
+    return 1;
+  }
+  std::atomic<int64_t> ioBudget(std::numeric_limits<int64_t>::max());
+  try {
+    const auto budget = std::stoll(options.at("--ioBudget").asString());
+    if (budget > 0) {
+      ioBudget = budget * 1024 * 1024;
+    }
+  } catch (const std::logic_error&) {
+    std::cerr << "I/O budget must be an integer" << std::endl;
+    return 1;
+  }
+  const bool integrity = options.at("--integrity").asBool();
+  const bool fix = options.at("--fix").asBool();
+
+  // Remote books (without a local ZIM file) have nothing to verify.
+  auto bookIds = options.at("ZIMID").asStringList();
+  if (bookIds.empty()) {
+    bookIds = library->filter(kiwix::Filter().local(true));
+  }
+  // An unknown id is a usage error, not a problem of the library to fix.
+  int exitCode = 0;
+  for (const auto& bookId : bookIds) {
+    try {
+      library->getBookById(bookId);
+    } catch (const std::out_of_range&) {
+      std::cerr << "Invalid book id '" << bookId << "'." << std::endl;
+      exitCode = 1;
+    }
+  }
+  if (exitCode) {
+    return exitCode;
+  }
+
+  std::vector<BookCheck> checks(bookIds.size());
+  runInParallel(bookIds.size(), nbThreads, [&](size_t i) {
+    checks[i] = checkBook(library->getBookByIdThreadSafe(bookIds[i]), integrity, ioBudget);
+  });
+
+  unsigned int problemCount = 0;
+  for (size_t i = 0; i < bookIds.size(); i++) {
+    const auto& check = checks[i];
+    if (check.status == BookStatus::OK) {
+      continue;
+    }
+    problemCount++;
+    std::cout << bookIds[i] << ": " << check.message << std::endl;
+    if (fix) {
+      library->removeBookById(bookIds[i]);
+      if (check.updatedBook) {
+        library->addBook(*check.updatedBook);
+      }
+    }
+  }
+
+  // Books sharing a name can't all be reached by their name in kiwix-serve.
+  std::map<std::string, std::vector<std::string>> booksByName;
+  for (const auto& id : library->filter(kiwix::Filter().local(true))) {
+    const auto& book = library->getBookById(id);
+    booksByName[book.getName() + (book.getFlavour().empty() ? "" : "_" + book.getFlavour())].push_back(id);
+  }
+  for (const auto& entry : booksByName) {
+    if (entry.second.size() > 1) {
+      std::cout << "Warning: books";
+      for (const auto& id : entry.second) {
+        std::cout << " " << id;
+      }
+      std::cout << " share the name " << entry.first << std::endl;
+    }
+  }
+
+  std::cout << bookIds.size() << " book(s) verified, " << problemCount << " problem(s) found"
+            << (fix && problemCount ? " and fixed" : "") << std::endl;
+  return problemCount && !fix ? 1 : 0;
+}
+
+/* Write the library, in XML or in the binary format. Write a temporary file in
+ * the same directory (the book paths are stored relatively to it) and rename
+ * it, so that a kiwix-serve monitoring the library never reads a partially
+ * written file. */
+bool writeLibrary(const kiwix::Library& library, const std::string& path, bool binary)
+{
+  namespace fs = std::filesystem;
+  std::error_code ec;
+  // Replace the target of a symlinked library file, keeping the symlink.
+  const auto target = fs::weakly_canonical(path, ec);
+  if (ec) {
+    return false;
+  }
+  if (target.parent_path() != fs::path(path).lexically_normal().parent_path()) {
+    // The book paths are relative to the directory of the symlink, so the
+    // temporary file can't be written next to the target: write through the
+    // symlink instead.
+    return binary ? writeBinaryLibrary(library, path) : library.writeToFile(path);
+  }
+
+  const auto tmpPath = target.string() + ".tmp";
+  bool written = binary ? writeBinaryLibrary(library, tmpPath)
+                        : library.writeToFile(tmpPath);
+  if (written && fs::exists(target, ec)) {
+    fs::permissions(tmpPath, fs::status(target, ec).permissions(), ec);
+  }
+  if (written) {
+    fs::rename(tmpPath, target, ec);
+    written = !ec;
+  }
+  if (!written) {
+    fs::remove(tmpPath, ec);
+  }
+  return written;
+}
+
+int handle_convert(const kiwix::Library& library, const std::string& libraryPath,
+                   const Options& options)
+{
+  auto outputPath = options.at("OUTPUTPATH").asString();
+  outputPath = kiwix::isRelativePath(outputPath)
+                 ? kiwix::computeAbsolutePath(kiwix::getCurrentDirectory(), outputPath)
+                 : outputPath;
+  if (!writeLibrary(library, outputPath, options.at("--binary").asBool())) {
+    std::cerr << "Cannot write the library " << outputPath << std::endl;
+    return 1;
+  }
+  return 0;
+}
+
 int main(int argc, char** argv)
 {
   supportedAction action = NONE;
@@ -191,13 +788,30 @@ int main(int argc, char** argv)
     action = SHOW;
   else if (args.at("remove").asBool() || args.at("delete").asBool())
     action = REMOVE;
+  else if (args.at("spellings").asBool())
+    action = SPELLINGS;
+  else if (args.at("convert").asBool())
+    action = CONVERT;
+  else if (args.at("verify").asBool())
+    action = VERIFY;
 
   /* Try to read the file */
   libraryPath = kiwix::isRelativePath(libraryPath)
                     ? kiwix::computeAbsolutePath(kiwix::getCurrentDirectory(), libraryPath)
                     : libraryPath;
-  kiwix::Manager manager(library);
-  if (!manager.readFile(libraryPath, false)) {
+  const bool binaryLibrary = BinaryLibrary::isBinaryLibrary(libraryPath);
+  if (binaryLibrary) {
+    // Showing some books of a binary library, by id or by name, only parses
+    // these books.
+    const auto bookIds = action == SHOW ? args.at("ZIMID").asStringList()
+                                        : std::vector<std::string>();
+    const auto bookName = action == SHOW && args.at("--name").isString()
+                        ? args.at("--name").asString() : std::string();
+    if (!readBinaryLibrary(library, libraryPath, bookIds, bookName)) {
+      std::cerr << "Cannot read the library " << libraryPath << std::endl;
+      return 1;
+    }
+  } else if (!kiwix::Manager(library).readFile(libraryPath, false)) {
     if (kiwix::fileExists(libraryPath) || action!=ADD) {
       std::cerr << "Cannot read the library " << libraryPath << std::endl;
       return 1;
@@ -216,6 +830,15 @@ int main(int argc, char** argv)
     case REMOVE:
       exitCode = handle_remove(*library, libraryPath, args);
       break;
+    case SPELLINGS:
+      exitCode = handle_spellings(*library, libraryPath, args);
+      break;
+    case CONVERT:
+      exitCode = handle_convert(*library, libraryPath, args);
+      break;
+    case VERIFY:
+      exitCode = handle_verify(library, libraryPath, args);
+      break;
     case NONE:
       break;
   }
@@ -224,10 +847,9 @@ int main(int argc, char** argv)
     return exitCode;
   }
 
-  /* Rewrite the library file */
-  if (action == REMOVE || action == ADD) {
-    // writeToFile return true (1) if everything is ok => exitCode is 0
-    if (!library->writeToFile(libraryPath)) {
+  /* Rewrite the library file, in its own format */
+  if (action == REMOVE || action == ADD || (action == VERIFY && args.at("--fix").asBool())) {
+    if (!writeLibrary(*library, libraryPath, binaryLibrary)) {
       std::cerr << "Cannot write the library " << libraryPath << std::endl;
       return 1;
     }
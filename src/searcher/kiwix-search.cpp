@@ -19,15 +19,30 @@
 
 #include <docopt/docopt.h>
 
+#include <kiwix/library.h>
+#include <kiwix/manager.h>
 #include <zim/search.h>
 #include <zim/suggestion.h>
 
 #include <kiwix/spelling_correction.h>
 #include <xapian.h>
 
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <fstream>
 #include <iostream>
 #include <filesystem>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <sstream>
+#include <thread>
 
+#include "../book_loader.h"
+#include "../cache_dir.h"
+#include "../json.h"
 #include "../version.h"
 
 using namespace std;
@@ -41,6 +56,9 @@ R"(Find articles based on a fulltext search pattern.
 
 Usage:
   kiwix-search [options] ZIM PATTERN
+  kiwix-search [options] (--zim=<path> | --library=<path>)... PATTERN
+  kiwix-search [options] --batch=<file> ZIM
+  kiwix-search [options] --batch=<file> (--zim=<path> | --library=<path>)...
   kiwix-search -h | --help
   kiwix-search -V | --version
 
@@ -52,16 +70,375 @@ Options:
   -s --suggestion    Suggest article titles based on the few letters of the PATTERN instead of making a fulltext search. Work a bit like a completion solution
   --spelling         Suggest article titles based on the spelling corrected PATTERN instead of making a fulltext search.
   -v --verbose       Give details about the search process
+  -b <file> --batch=<file>          Run every query (one per line) of this file, or of STDIN if <file> is '-', and print the results and timings as JSON lines
+  -t <threads> --threads=<threads>  Number of threads running the queries of a batch, or profiling the ZIM files [default: 4]
+  -z <path> --zim=<path>            ZIM file to search. Can be repeated to search several ZIM files at once
+  -l <path> --library=<path>        XML library file whose ZIM files are searched. Can be repeated
+  --searchLimit=<limit>             Maximal number of ZIM files searched at once (0 means no limit) [default: 0]
+  --profile                         Also search each ZIM file separately and report the time spent in each of them
+  --start=<start>                   Index of the first result to print [default: 0]
+  --count=<count>                   Number of results to print (default: 10, or 1 with --spelling)
+  --fields=<fields>                 Comma separated fields printed for each result: title, path, zim, score, wordcount, snippet [default: title]
+  -j --json                         Print the results and the estimated number of matches as a JSON object
+  --cacheDir=<dir>                  Directory of the spellings databases (default: $XDG_CACHE_HOME/kiwix, $HOME/.cache/kiwix or $TMPDIR/kiwix-<uid>)
   -V --version       Print software version
   -h --help          Print this help
 )";
 
-std::filesystem::path getKiwixCachedDataDirPath()
+enum class Mode { FULLTEXT, SUGGESTION, SPELLING };
+
+enum class Field { TITLE, PATH, ZIM, SCORE, WORDCOUNT, SNIPPET };
+typedef std::vector<Field> Fields;
+
+typedef std::vector<zim::Archive> Archives;
+
+struct SearchOptions {
+  Mode mode = Mode::FULLTEXT;
+  bool verbose = false;
+  bool profile = false;
+  unsigned int start = 0;
+  unsigned int count = 10;
+  Fields fields;
+  std::filesystem::path cacheDir;
+};
+
+bool parseFields(const std::string& str, Fields& fields)
 {
-  std::filesystem::path home(getenv("HOME"));
-  std::filesystem::path cacheDirPath = home / ".cache" / "kiwix";
-  std::filesystem::create_directories(cacheDirPath);
-  return cacheDirPath;
+  static const std::map<std::string, Field> names = {
+    {"title", Field::TITLE},
+    {"path", Field::PATH},
+    {"zim", Field::ZIM},
+    {"score", Field::SCORE},
+    {"wordcount", Field::WORDCOUNT},
+    {"snippet", Field::SNIPPET}
+  };
+  std::istringstream in(str);
+  std::string name;
+  while (std::getline(in, name, ',')) {
+    const auto it = names.find(name);
+    if (it == names.end()) {
+      return false;
+    }
+    fields.push_back(it->second);
+  }
+  return !fields.empty();
+}
+
+/* Print the results of a query as they are produced, either as one line of
+ * tab separated fields per result or as the members of a JSON object.
+ * The values of the fields are only retrieved if they are printed, so that
+ * a large window of results doesn't compute unneeded snippets. */
+class ResultPrinter
+{
+ public:
+  ResultPrinter(std::ostream& out, const Fields& fields, bool json, bool compact)
+    : m_out(out),
+      m_fields(fields),
+      m_json(json),
+      m_compact(compact)
+  {}
+
+  void begin(int estimatedMatches)
+  {
+    if (m_json) {
+      m_out << "\"estimated_matches\": " << estimatedMatches << ", \"results\": [";
+    }
+  }
+
+  /* `getValue(Field)` returns the value of a field of the result, or nothing
+   * if the field doesn't apply to this kind of search. */
+  template<typename Getter>
+  void add(Getter getValue)
+  {
+    if (m_json) {
+      m_out << (m_first ? (m_compact ? "" : "\n  ") : (m_compact ? ", " : ",\n  ")) << "{";
+    }
+    for (size_t i = 0; i < m_fields.size(); i++) {
+      const auto field = m_fields[i];
+      const std::optional<std::string> value = getValue(field);
+      if (m_json) {
+        m_out << (i ? ", " : "") << jsonString(fieldName(field)) << ": ";
+        if (!value) {
+          m_out << "null";
+        } else if (field == Field::SCORE || field == Field::WORDCOUNT) {
+          m_out << *value;
+        } else {
+          m_out << jsonString(*value);
+        }
+      } else {
+        auto text = value.value_or("");
+        std::replace_if(text.begin(), text.end(), [](char c) { return c == '\t' || c == '\n' || c == '\r'; }, ' ');
+        m_out << (i ? "\t" : "") << text;
+      }
+    }
+    m_out << (m_json ? "}" : "\n");
+    m_first = false;
+  }
+
+  void end()
+  {
+    if (m_json) {
+      m_out << (m_compact || m_first ? "]" : "\n]");
+    }
+  }
+
+ private:
+  static const char* fieldName(Field field)
+  {
+    switch (field) {
+      case Field::TITLE: return "title";
+      case Field::PATH: return "path";
+      case Field::ZIM: return "zim";
+      case Field::SCORE: return "score";
+      case Field::WORDCOUNT: return "wordcount";
+      case Field::SNIPPET: return "snippet";
+    }
+    return "";
+  }
+
+  std::ostream& m_out;
+  const Fields& m_fields;
+  bool m_json;
+  bool m_compact;
+  bool m_first = true;
+};
+
+/* Time spent by the search of the pattern in one archive */
+struct ArchiveTiming {
+  double time = 0; // in milliseconds
+  int matches = 0;
+  std::string error;
+};
+
+/* Run queries against the archives. The zim searchers are not thread-safe, so
+ * the batch mode creates one runner per worker thread. They all share the same
+ * archives, so the archives and their caches are opened only once.
+ * A fulltext search uses a single searcher over all the archives: Xapian ranks
+ * the results of all of them with the same term statistics, so the scores of
+ * results coming from different archives are directly comparable. */
+class QueryRunner
+{
+ public:
+  QueryRunner(const Archives& archives, const std::vector<std::string>& zimPaths,
+              const SearchOptions& options)
+    : m_archives(archives),
+      m_zimPaths(zimPaths),
+      m_mode(options.mode),
+      m_verbose(options.verbose)
+  {
+    const auto verbose = options.verbose;
+    switch (options.mode) {
+      case Mode::FULLTEXT:
+        mp_searcher.reset(new zim::Searcher(archives));
+        mp_searcher->setVerbose(verbose);
+        break;
+      case Mode::SUGGESTION:
+        mp_suggestionSearcher.reset(new zim::SuggestionSearcher(archives.front()));
+        mp_suggestionSearcher->setVerbose(verbose);
+        break;
+      case Mode::SPELLING:
+        mp_spellingsDB.reset(new kiwix::SpellingsDB(archives.front(), options.cacheDir));
+        break;
+    }
+  }
+
+  /* Run the query and print the results [start, start+count[ as they are
+   * retrieved, without materializing the result set. */
+  void run(const std::string& pattern, unsigned int start, unsigned int count,
+           ResultPrinter& printer)
+  {
+    switch (m_mode) {
+      case Mode::FULLTEXT: {
+        const auto search = mp_searcher->search(zim::Query(pattern));
+        const auto results = search.getResults(start, count);
+        printer.begin(search.getEstimatedMatches());
+        for (auto it = results.begin(); it != results.end(); ++it) {
+          printer.add([&](Field field) -> std::optional<std::string> {
+            switch (field) {
+              case Field::TITLE: return it.getTitle();
+              case Field::PATH: return it.getPath();
+              case Field::ZIM: return m_zimPaths[it.getFileIndex()];
+              case Field::SCORE: return std::to_string(it.getScore());
+              case Field::WORDCOUNT: return std::to_string(it.getWordCount());
+              case Field::SNIPPET: return it.getSnippet();
+            }
+            return std::nullopt;
+          });
+        }
+        break;
+      }
+      case Mode::SUGGESTION: {
+        const auto search = mp_suggestionSearcher->suggest(pattern);
+        const auto results = search.getResults(start, count);
+        printer.begin(search.getEstimatedMatches());
+        for (auto it = results.begin(); it != results.end(); ++it) {
+          printer.add([&](Field field) -> std::optional<std::string> {
+            switch (field) {
+              case Field::TITLE: return it->getTitle();
+              case Field::PATH: return it->getPath();
+              case Field::ZIM: return m_zimPaths.front();
+              case Field::SNIPPET: return it->hasSnippet() ? it->getSnippet() : "";
+              default: return std::nullopt;
+            }
+          });
+        }
+        break;
+      }
+      case Mode::SPELLING: {
+        const auto corrections = mp_spellingsDB->getSpellingCorrections(pattern, start + count);
+        printer.begin(corrections.size());
+        for (size_t i = start; i < corrections.size(); i++) {
+          printer.add([&](Field field) -> std::optional<std::string> {
+            if (field == Field::TITLE) {
+              return corrections[i];
+            }
+            return std::nullopt;
+          });
+        }
+        break;
+      }
+    }
+    printer.end();
+  }
+
+  /* Search the pattern in each archive separately, on (at most) `nbThreads`
+   * threads, to measure the time spent in each of them. */
+  std::vector<ArchiveTiming> profile(const std::string& pattern, unsigned int nbThreads)
+  {
+    if (m_archiveSearchers.empty()) {
+      for (const auto& archive : m_archives) {
+        m_archiveSearchers.emplace_back(new zim::Searcher(archive));
+        m_archiveSearchers.back()->setVerbose(m_verbose);
+      }
+    }
+
+    std::vector<ArchiveTiming> timings(m_archives.size());
+    runInParallel(m_archives.size(), nbThreads, [&](size_t i) {
+      const auto start = std::chrono::steady_clock::now();
+      try {
+        auto search = m_archiveSearchers[i]->search(zim::Query(pattern));
+        search.getResults(0, 10);
+        timings[i].matches = search.getEstimatedMatches();
+      } catch (const Xapian::Error& err) {
+        timings[i].error = err.get_msg();
+      } catch (const std::exception& err) {
+        timings[i].error = err.what();
+      }
+      const std::chrono::duration<double, std::milli> duration = std::chrono::steady_clock::now() - start;
+      timings[i].time = duration.count();
+    });
+    return timings;
+  }
+
+ private:
+  Archives m_archives;
+  std::vector<std::string> m_zimPaths;
+  Mode m_mode;
+  bool m_verbose;
+  std::unique_ptr<zim::Searcher> mp_searcher;
+  std::unique_ptr<zim::SuggestionSearcher> mp_suggestionSearcher;
+  std::unique_ptr<kiwix::SpellingsDB> mp_spellingsDB;
+  std::vector<std::unique_ptr<zim::Searcher>> m_archiveSearchers;
+};
+
+std::vector<std::string> readQueries(std::istream& in)
+{
+  std::vector<std::string> queries;
+  std::string line;
+  while (std::getline(in, line)) {
+    if (!line.empty() && line.back() == '\r') {
+      line.pop_back();
+    }
+    if (!line.empty()) {
+      queries.push_back(line);
+    }
+  }
+  return queries;
+}
+
+/* Run the queries on `nbThreads` workers and print one JSON line per query,
+ * in the order of the queries, as soon as it is available. */
+void runBatch(const Archives& archives, const std::vector<std::string>& zimPaths,
+              const SearchOptions& options,
+              const std::vector<std::string>& queries, unsigned int nbThreads)
+{
+  if (options.mode == Mode::SPELLING) {
+    // Build the spellings database once before the workers open it.
+    QueryRunner builder(archives, zimPaths, options);
+  }
+
+  std::vector<std::string> outputs(queries.size());
+  std::vector<bool> done(queries.size(), false);
+  std::mutex mutex;
+  std::condition_variable cond;
+  size_t next = 0;
+
+  auto worker = [&]() {
+    QueryRunner runner(archives, zimPaths, options);
+    while (true) {
+      size_t i;
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (next >= queries.size()) {
+          return;
+        }
+        i = next++;
+      }
+      std::ostringstream out;
+      out << "{\"query\": " << jsonString(queries[i]);
+      const auto start = std::chrono::steady_clock::now();
+      try {
+        std::ostringstream results;
+        ResultPrinter printer(results, options.fields, true, true);
+        runner.run(queries[i], options.start, options.count, printer);
+        const std::chrono::duration<double, std::milli> duration = std::chrono::steady_clock::now() - start;
+        out << ", \"time_ms\": " << duration.count() << ", " << results.str();
+        if (options.profile) {
+          // The queries already run in parallel, profile each one on its thread.
+          const auto timings = runner.profile(queries[i], 1);
+          out << ", \"zims\": [";
+          for (size_t j = 0; j < timings.size(); j++) {
+            out << (j ? ", " : "") << "{\"zim\": " << jsonString(zimPaths[j])
+                << ", \"time_ms\": " << timings[j].time;
+            if (timings[j].error.empty()) {
+              out << ", \"matches\": " << timings[j].matches << "}";
+            } else {
+              out << ", \"error\": " << jsonString(timings[j].error) << "}";
+            }
+          }
+          out << "]";
+        }
+        out << "}";
+      } catch (const Xapian::Error& err) {
+        out << ", \"error\": " << jsonString(err.get_msg()) << "}";
+      } catch (const std::exception& err) {
+        out << ", \"error\": " << jsonString(err.what()) << "}";
+      }
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        outputs[i] = out.str();
+        done[i] = true;
+      }
+      cond.notify_one();
+    }
+  };
+
+  nbThreads = std::max(1U, std::min<unsigned int>(nbThreads, queries.size()));
+  std::vector<std::thread> threads;
+  for (unsigned int i = 0; i < nbThreads; i++) {
+    threads.emplace_back(worker);
+  }
+  for (size_t i = 0; i < queries.size(); i++) {
+    std::unique_lock<std::mutex> lock(mutex);
+    cond.wait(lock, [&]() { return done[i]; });
+    const auto output = std::move(outputs[i]);
+    lock.unlock();
+    cout << output << '\n';
+  }
+  cout << flush;
+  for (auto& thread : threads) {
+    thread.join();
+  }
 }
 
 int main(int argc, char** argv)
@@ -85,31 +462,148 @@ int main(int argc, char** argv)
     return 0;
   }
 
-  auto zimPath = args.at("ZIM").asString();
-  auto pattern = args.at("PATTERN").asString();
-  auto verboseFlag = args.at("--verbose").asBool();
+  SearchOptions options;
+  options.verbose = args.at("--verbose").asBool();
+  if (args.at("--suggestion").asBool()) {
+    options.mode = Mode::SUGGESTION;
+  } else if (args.at("--spelling").asBool()) {
+    options.mode = Mode::SPELLING;
+  }
+  options.profile = args.at("--profile").asBool() && options.mode == Mode::FULLTEXT;
+  auto jsonFlag = args.at("--json").asBool();
+
+  unsigned int nbThreads;
+  unsigned int searchLimit;
+  try {
+    nbThreads = std::stoul(args.at("--threads").asString());
+    searchLimit = std::stoul(args.at("--searchLimit").asString());
+    options.start = std::stoul(args.at("--start").asString());
+    if (args.at("--count").isString()) {
+      options.count = std::stoul(args.at("--count").asString());
+    } else if (options.mode == Mode::SPELLING) {
+      // Only the best correction, as before --count existed
+      options.count = 1;
+    }
+  } catch (const std::logic_error&) {
+    std::cerr << "Number of threads, search limit, start and count must be integers" << std::endl;
+    return -1;
+  }
+
+  if (!parseFields(args.at("--fields").asString(), options.fields)) {
+    std::cerr << "Invalid fields '" << args.at("--fields").asString() << "'" << std::endl;
+    std::cerr << USAGE << std::endl;
+    return -1;
+  }
+
+  std::vector<std::string> zimPaths;
+  if (args.at("ZIM").isString()) {
+    zimPaths.push_back(args.at("ZIM").asString());
+  }
+  for (const auto& zimPath : args.at("--zim").asStringList()) {
+    zimPaths.push_back(zimPath);
+  }
+  // The ZIM files coming from a library are skipped if they can't be opened.
+  std::set<std::string> libraryZimPaths;
+  for (const auto& libraryPath : args.at("--library").asStringList()) {
+    auto library = kiwix::Library::create();
+    kiwix::Manager manager(library);
+    // Don't trust the library, so that the missing ZIM files are not valid.
+    if (!manager.readFile(libraryPath, true, false)) {
+      cerr << "Cannot read the library file " << libraryPath << endl;
+      exit(1);
+    }
+    for (const auto& id : library->filter(kiwix::Filter().local(true))) {
+      const auto& book = library->getBookById(id);
+      if (!book.isPathValid()) {
+        cerr << "WARNING: Skipping " << book.getPath() << ": the file doesn't exist" << endl;
+        continue;
+      }
+      zimPaths.push_back(book.getPath());
+      libraryZimPaths.insert(book.getPath());
+    }
+  }
+  // The same ZIM file may be listed several times, search it only once.
+  std::set<std::string> seenPaths;
+  zimPaths.erase(std::remove_if(zimPaths.begin(), zimPaths.end(),
+                                [&](const std::string& path) { return !seenPaths.insert(path).second; }),
+                 zimPaths.end());
+
+  if (zimPaths.empty()) {
+    cerr << "No ZIM file to search" << endl;
+    exit(1);
+  }
+  if (searchLimit && zimPaths.size() > searchLimit) {
+    cerr << "Too many ZIM files to search (" << zimPaths.size()
+         << "), the search limit is " << searchLimit << endl;
+    exit(1);
+  }
+  if (options.mode != Mode::FULLTEXT && zimPaths.size() > 1) {
+    cerr << "Suggestions and spelling corrections work on a single ZIM file" << endl;
+    exit(1);
+  }
 
   /* Try to prepare the indexing */
   try {
-    zim::Archive archive(zimPath);
+    if (options.mode == Mode::SPELLING) {
+      options.cacheDir = getKiwixCacheDir(args.at("--cacheDir").isString() ? args.at("--cacheDir").asString() : "");
+    }
 
-    if (args.at("--suggestion").asBool()) {
-      zim::SuggestionSearcher searcher(archive);
-      searcher.setVerbose(verboseFlag);
-      for (const auto& r:searcher.suggest(pattern).getResults(0, 10)) {
-        cout << r.getTitle() << endl;
+    Archives archives;
+    std::vector<std::string> openedPaths;
+    for (const auto& zimPath : zimPaths) {
+      try {
+        archives.emplace_back(zimPath);
+        openedPaths.push_back(zimPath);
+      } catch (const std::runtime_error& err) {
+        if (!libraryZimPaths.count(zimPath)) {
+          throw;
+        }
+        cerr << "WARNING: Skipping " << zimPath << ": " << err.what() << endl;
       }
-    }  else if (args.at("--spelling").asBool()) {
-      kiwix::SpellingsDB spellingsDB(archive, getKiwixCachedDataDirPath());
-      for (const auto& r:spellingsDB.getSpellingCorrections(pattern, 1)) {
-        cout << r << endl;
+    }
+    zimPaths = openedPaths;
+    if (archives.empty()) {
+      cerr << "No ZIM file to search" << endl;
+      exit(1);
+    }
+
+    if (args.at("--batch").isString()) {
+      const auto batchPath = args.at("--batch").asString();
+      std::vector<std::string> queries;
+      if (batchPath == "-") {
+        queries = readQueries(std::cin);
+      } else {
+        std::ifstream in(batchPath);
+        if (!in) {
+          cerr << "Cannot open the batch file " << batchPath << endl;
+          exit(1);
+        }
+        queries = readQueries(in);
       }
+      runBatch(archives, zimPaths, options, queries, nbThreads);
     } else {
-      zim::Searcher searcher(archive);
-      searcher.setVerbose(verboseFlag);
-      const zim::Query query(pattern);
-      for (const auto& r : searcher.search(query).getResults(0, 10) ) {
-        cout << r.getTitle() << endl;
+      const auto pattern = args.at("PATTERN").asString();
+      QueryRunner runner(archives, zimPaths, options);
+      ResultPrinter printer(cout, options.fields, jsonFlag, false);
+      if (jsonFlag) {
+        cout << "{\"query\": " << jsonString(pattern) << ", ";
+      }
+      runner.run(pattern, options.start, options.count, printer);
+      if (jsonFlag) {
+        cout << "}\n";
+      }
+      cout << flush;
+      if (options.profile) {
+        const auto timings = runner.profile(pattern, nbThreads);
+        for (size_t i = 0; i < timings.size(); i++) {
+          cerr << zimPaths[i] << ": ";
+          if (timings[i].error.empty()) {
+            cerr << timings[i].matches << " matches";
+          } else {
+            cerr << timings[i].error;
+          }
+          cerr << " in " << timings[i].time << " ms" << endl;
+        }
       }
     }
   } catch ( const std::runtime_error& err)  {
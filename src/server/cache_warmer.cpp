@@ -0,0 +1,195 @@
+/*
+ * Copyright 2026 Kiwix <contact@kiwix.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+
+#include "cache_warmer.h"
+
+#include <zim/archive.h>
+#include <zim/item.h>
+
+#include <cctype>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <map>
+
+#ifndef _WIN32
+# include <fcntl.h>
+# include <unistd.h>
+#endif
+#ifdef __linux__
+# include <sys/resource.h>
+# include <sys/syscall.h>
+#endif
+
+namespace
+{
+
+std::string urlDecode(const std::string& str)
+{
+  std::string out;
+  for (size_t i = 0; i < str.size(); i++) {
+    if (str[i] == '%' && i + 2 < str.size() && isxdigit(static_cast<unsigned char>(str[i+1]))
+                                         && isxdigit(static_cast<unsigned char>(str[i+2]))) {
+      out += static_cast<char>(std::stoi(str.substr(i + 1, 2), nullptr, 16));
+      i += 2;
+    } else {
+      out += str[i];
+    }
+  }
+  return out;
+}
+
+bool startsWith(const std::string& str, const std::string& prefix)
+{
+  return str.compare(0, prefix.size(), prefix) == 0;
+}
+
+/* Make the calling thread use the CPU and the disk only when nothing else
+ * needs them */
+void lowerThreadPriority()
+{
+#ifdef __linux__
+  const auto tid = syscall(SYS_gettid);
+  setpriority(PRIO_PROCESS, tid, 19);
+#ifdef SYS_ioprio_set
+  // ioprio_set(IOPRIO_WHO_PROCESS, tid, IOPRIO_PRIO_VALUE(IOPRIO_CLASS_IDLE, 0))
+  syscall(SYS_ioprio_set, 1, tid, 3 << 13);
+#endif
+#endif
+}
+
+} // unnamed namespace
+
+CacheWarmer::CacheWarmer(kiwix::LibraryPtr library, std::shared_ptr<kiwix::NameMapper> nameMapper)
+  : mp_library(library),
+    mp_nameMapper(nameMapper),
+    m_stopped(false)
+{}
+
+CacheWarmer::~CacheWarmer()
+{
+  stop();
+}
+
+bool CacheWarmer::readUrlList(const std::string& path, const std::string& rootLocation)
+{
+  std::ifstream in(path);
+  if (!in) {
+    std::cerr << "Unable to read the warmup list '" << path << "'" << std::endl;
+    return false;
+  }
+
+  std::string root = rootLocation;
+  while (!root.empty() && root.back() == '/') {
+    root.pop_back();
+  }
+  std::string url;
+  while (std::getline(in, url)) {
+    const auto scheme = url.find("://");
+    if (scheme != std::string::npos) {
+      url.erase(0, url.find('/', scheme + 3));
+    }
+    url = url.substr(0, url.find_first_of("?#\r"));
+    if (!root.empty() && startsWith(url, root + "/")) {
+      url.erase(0, root.size());
+    }
+    if (startsWith(url, "/")) {
+      url.erase(0, 1);
+    }
+    if (startsWith(url, "content/")) {
+      url.erase(0, 8);
+    }
+    const auto slash = url.find('/');
+    if (slash == std::string::npos || slash + 1 == url.size()) {
+      continue;
+    }
+    m_entries.emplace_back(url.substr(0, slash), urlDecode(url.substr(slash + 1)));
+  }
+  return true;
+}
+
+void CacheWarmer::start()
+{
+  if (!m_entries.empty()) {
+    m_thread = std::thread(&CacheWarmer::run, this);
+  }
+}
+
+void CacheWarmer::stop()
+{
+  m_stopped = true;
+  if (m_thread.joinable()) {
+    m_thread.join();
+  }
+}
+
+bool CacheWarmer::warmup(const std::string& bookName, const std::string& path)
+{
+  try {
+    const auto archive = mp_library->getArchiveById(mp_nameMapper->getIdForName(bookName));
+    if (!archive) {
+      return false;
+    }
+    const auto item = archive->getEntryByPath(path).getItem(true);
+#ifndef _WIN32
+    const auto info = item.getDirectAccessInformation();
+    if (info.isValid()) {
+      // Uncompressed content is served straight from the file:
+      // ask the kernel to read it ahead into the page cache.
+      const int fd = open(info.filename.c_str(), O_RDONLY | O_CLOEXEC);
+      if (fd >= 0) {
+#ifdef POSIX_FADV_WILLNEED
+        posix_fadvise(fd, info.offset, item.getSize(), POSIX_FADV_WILLNEED);
+#endif
+        close(fd);
+        return true;
+      }
+    }
+#endif
+    // Compressed content: decompressing it fills the cluster cache
+    item.getData();
+    return true;
+  } catch (...) {
+    return false;
+  }
+}
+
+void CacheWarmer::run()
+{
+  lowerThreadPriority();
+  const auto start = std::chrono::steady_clock::now();
+  std::cout << "Warming up the caches with " << m_entries.size() << " entries" << std::endl;
+
+  size_t done = 0, missing = 0;
+  for (const auto& entry : m_entries) {
+    if (m_stopped) {
+      break;
+    }
+    if (!warmup(entry.first, entry.second)) {
+      missing++;
+    }
+    if (++done % 1000 == 0) {
+      std::cout << "Cache warmup: " << done << "/" << m_entries.size() << " entries" << std::endl;
+    }
+  }
+
+  const auto duration = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  std::cout << "Cache warmup done: " << done << "/" << m_entries.size()
+            << " entries (" << missing << " not found) in " << duration << "s" << std::endl;
+}
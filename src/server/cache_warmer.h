@@ -0,0 +1,60 @@
+/*
+ * Copyright 2026 Kiwix <contact@kiwix.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+
+#ifndef _KIWIX_SERVE_CACHE_WARMER_H_
+#define _KIWIX_SERVE_CACHE_WARMER_H_
+
+#include <kiwix/library.h>
+#include <kiwix/name_mapper.h>
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/* Prefetches a list of ZIM entries in a low priority background thread, so
+ * that they are already in the OS page cache (or, for compressed content, in
+ * the libzim cluster cache) when they are first requested. */
+class CacheWarmer
+{
+ public:
+  CacheWarmer(kiwix::LibraryPtr library, std::shared_ptr<kiwix::NameMapper> nameMapper);
+  ~CacheWarmer();
+
+  /* Read the entries to prefetch from a file listing one URL per line, as
+   * served by kiwix-serve under `rootLocation` (e.g. `/content/BOOK/PATH`). */
+  bool readUrlList(const std::string& path, const std::string& rootLocation);
+
+  void start();
+  void stop();
+
+ private:
+  void run();
+  bool warmup(const std::string& bookName, const std::string& path);
+
+  kiwix::LibraryPtr mp_library;
+  std::shared_ptr<kiwix::NameMapper> mp_nameMapper;
+  std::vector<std::pair<std::string, std::string>> m_entries;
+  std::atomic<bool> m_stopped;
+  std::thread m_thread;
+};
+
+#endif //_KIWIX_SERVE_CACHE_WARMER_H_
@@ -23,14 +23,28 @@
 #include <kiwix/server.h>
 #include <kiwix/name_mapper.h>
 #include <kiwix/tools.h>
+#include <zim/archive.h>
 
 #ifdef _WIN32
 # include <windows.h>
 #else
 # include <unistd.h>
 # include <signal.h>
+# include <sys/wait.h>
+#endif
+#ifdef __linux__
+# include <sched.h>
 #endif
 #include <sys/stat.h>
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
 
 #ifdef __APPLE__
 # import <sys/sysctl.h>
@@ -38,7 +52,14 @@
 # define MIBSIZE 4
 #endif
 
+#include "../book_loader.h"
 #include "../version.h"
+#include "cache_warmer.h"
+#include "library_reloader.h"
+#include "library_scanner.h"
+#include "library_watcher.h"
+#include "log_writer.h"
+#include "metrics.h"
 
 #define DEFAULT_THREADS 4
 #define LITERAL_AS_STR(A) #A
@@ -51,6 +72,7 @@ R"(Deliver ZIM file(s) articles via HTTP
 Usage:
  kiwix-serve [options] ZIMPATH ...
  kiwix-serve [options] (-l | --library) LIBRARYPATH
+ kiwix-serve [options] --libraryDir=<dir>
  kiwix-serve -h | --help
  kiwix-serve -V | --version
 
@@ -73,12 +95,28 @@ Options:
  -r <root> --urlRootLocation=<root>      URL prefix on which the content should be made available [default: /]
  -s <limit> --searchLimit=<limit>        Maximun number of zim in a fulltext multizim search [default: 0]
  -t <threads> --threads=<threads>        Number of threads to run in parallel [default: )" AS_STR(DEFAULT_THREADS) R"(]
+ --cacheSize=<MB>                        Memory (in MB) used to cache decompressed ZIM content, shared by all the ZIM files (0 keeps the libzim default) [default: 0]
+ --searchCacheSize=<n>                   Number of fulltext searches kept in memory to serve their other result pages and the identical searches (0 keeps the libkiwix default) [default: 0]
+ --archiveCacheSize=<n>                  Maximum number of ZIM files kept open, the least recently used ones being closed (0 keeps the libkiwix default) [default: 0]
+ --searcherCacheSize=<n>                 Maximum number of fulltext search databases kept open (0 keeps the libkiwix default) [default: 0]
+ --suggestionCacheSize=<n>               Maximum number of title suggestion databases kept open (0 keeps the libkiwix default) [default: 0]
+ --loadThreads=<threads>                 Number of threads opening the ZIM files at startup (0 means the value of --threads) [default: 0]
  -v --verbose                            Print debug log to STDOUT
+ --logFile=<path>                        Write the output (including the debug log) to this file instead of STDOUT, reopened on SIGHUP
+ --logFormat=<format>                    Format of the lines of the log file: 'text' or 'json' [default: text]
  -V --version                            Print software version
  -z --nodatealiases                      Create URL aliases for each content by removing the date
  -c <path> --customIndex=<path>          Add path to custom index.html for welcome page
  -L <limit> --ipConnectionLimit=<limit>  Max number of (concurrent) connections per IP [default: 0] (recommended: >= 6)
  -k --skipInvalid                        Startup even when ZIM files are invalid (those will be skipped)
+ --libraryDir=<dir>                      Serve the ZIM files found (recursively) in this directory
+ --libraryDirCache=<path>                XML library file where to cache the metadata of the ZIM files found with --libraryDir
+ --warmupList=<path>                     File listing URLs (one per line) whose content is prefetched in the background after startup
+ --metricsPort=<port>                    Port on which to serve metrics in the Prometheus format under /metrics (0 to disable) [default: 0]
+ --workers=<n>                           Number of worker processes serving on consecutive ports from --port, supervised and restarted by the main process (0 to serve from the main process) [default: 0]
+ --cpuAffinity                           Pin each worker process to a CPU (Linux only)
+ --shutdownDelay=<seconds>               Time during which the requests are still served after SIGTERM, while /ready of the metrics server answers 503 [default: 0]
+ --shutdownTimeout=<seconds>             Maximum time to wait for the running requests to complete before exiting anyway [default: 10]
 
 Documentation:
   Source code   https://github.com/kiwix/kiwix-tools
@@ -86,6 +124,65 @@ Documentation:
                 https://kiwix-tools.readthedocs.io/en/latest/kiwix-serve.html
 )";
 
+/* Stop the server, which waits for the running requests to complete.
+ * Return false if they don't complete within `timeout` seconds. */
+bool stopServer(kiwix::Server& server, unsigned int timeout)
+{
+  struct StopState {
+    std::mutex mutex;
+    std::condition_variable stopped;
+    bool done = false;
+  };
+  /* Shared with the stopper thread, which may outlive this function */
+  auto state = std::make_shared<StopState>();
+  std::thread([&server, state]() {
+    server.stop();
+    std::lock_guard<std::mutex> lock(state->mutex);
+    state->done = true;
+    state->stopped.notify_one();
+  }).detach();
+  std::unique_lock<std::mutex> lock(state->mutex);
+  return state->stopped.wait_for(lock, std::chrono::seconds(timeout),
+                                 [&]() { return state->done; });
+}
+
+/* libkiwix reads the size of its caches from environment variables, when
+ * creating the library or starting the server */
+void setLibkiwixCacheSize(const char* name, unsigned int size)
+{
+  const auto value = std::to_string(size);
+#ifdef _WIN32
+  _putenv_s(name, value.c_str());
+#else
+  setenv(name, value.c_str(), 1);
+#endif
+}
+
+bool processIsRunning(unsigned int pid)
+{
+#ifdef _WIN32
+  HANDLE process = OpenProcess(SYNCHRONIZE, FALSE, pid);
+  DWORD ret = WaitForSingleObject(process, 0);
+  CloseHandle(process);
+  return ret == WAIT_TIMEOUT;
+#elif __APPLE__
+  int mib[MIBSIZE];
+  struct kinfo_proc kp;
+  size_t len = sizeof(kp);
+
+  mib[0] = CTL_KERN;
+  mib[1] = KERN_PROC;
+  mib[2] = KERN_PROC_PID;
+  mib[3] = pid;
+
+  int ret = sysctl(mib, MIBSIZE, &kp, &len, NULL, 0);
+  return ret != -1 && len > 0;
+#else /* Linux & co */
+  std::string procPath = "/proc/" + std::to_string(pid);
+  return access(procPath.c_str(), F_OK) != -1;
+#endif
+}
+
 std::string loadCustomTemplate (std::string customIndexPath) {
   customIndexPath = kiwix::isRelativePath(customIndexPath) ?
                       kiwix::computeAbsolutePath(kiwix::getCurrentDirectory(), customIndexPath) :
@@ -107,17 +204,23 @@ std::string loadCustomTemplate (std::string customIndexPath) {
 #ifndef _WIN32
 volatile sig_atomic_t waiting = false;
 volatile sig_atomic_t libraryMustBeReloaded = false;
+/* Set by SIGHUP: parse all the library files again, even the unchanged ones */
+volatile sig_atomic_t libraryReloadForced = false;
 void handle_sigterm(int signum)
 {
     if ( waiting == false ) {
         _exit(signum);
     }
     waiting = false;
+    LibraryWatcher::wakeUp();
 }
 
 void handle_sighup(int signum)
 {
   libraryMustBeReloaded = true;
+  libraryReloadForced = true;
+  LogWriter::reopen();
+  LibraryWatcher::wakeUp();
 }
 
 typedef void (*SignalHandler)(int);
@@ -136,9 +239,96 @@ void setup_sighandlers()
     set_signal_handler(SIGINT,  &handle_sigterm);
     set_signal_handler(SIGHUP,  &handle_sighup);
 }
+
+/* Pin the calling process to one CPU */
+void pinToCpu(unsigned int index)
+{
+#ifdef __linux__
+  const auto nbCpus = std::max(1u, std::thread::hardware_concurrency());
+  cpu_set_t cpus;
+  CPU_ZERO(&cpus);
+  CPU_SET(index % nbCpus, &cpus);
+  if (sched_setaffinity(0, sizeof(cpus), &cpus) != 0) {
+    std::cerr << "Unable to pin worker " << index << " to a CPU" << std::endl;
+  }
+#endif
+}
+
+/* Fork `nbWorkers` worker processes and restart them when they die, until
+ * SIGTERM/SIGINT is received (or `parentPid` dies). SIGHUP and SIGTERM are
+ * forwarded to the workers. As the workers are forked after the library is
+ * loaded, they share its memory with the supervisor.
+ * Return the index of the worker in the worker processes, and -1 in the
+ * supervisor once all the workers exited. */
+int superviseWorkers(unsigned int nbWorkers, bool cpuAffinity, unsigned int parentPid)
+{
+  std::vector<pid_t> workers(nbWorkers, 0);
+  waiting = true;
+  while (waiting) {
+    for (unsigned int i = 0; i < nbWorkers; i++) {
+      if (workers[i] > 0) {
+        continue;
+      }
+      const pid_t pid = fork();
+      if (pid == 0) {
+        /* Until its main loop runs, a signal makes the worker exit */
+        waiting = false;
+        if (cpuAffinity) {
+          pinToCpu(i);
+        }
+        return i;
+      }
+      if (pid < 0) {
+        std::cerr << "Unable to start worker " << i << std::endl;
+      }
+      workers[i] = std::max(pid, 0);
+    }
+
+    /* Waiting one second between the checks also throttles the restart of
+     * workers crashing at startup */
+    sleep(1);
+
+    if (parentPid > 0 && !processIsRunning(parentPid)) {
+      waiting = false;
+    }
+    if (libraryMustBeReloaded) {
+      libraryMustBeReloaded = false;
+      for (const auto pid : workers) {
+        if (pid > 0) {
+          kill(pid, SIGHUP);
+        }
+      }
+    }
+    int status;
+    pid_t pid;
+    while ((pid = waitpid(-1, &status, WNOHANG)) > 0) {
+      const auto it = std::find(workers.begin(), workers.end(), pid);
+      if (it == workers.end()) {
+        continue;
+      }
+      *it = 0;
+      std::cerr << "Worker " << it - workers.begin() << " (pid " << pid << ") ";
+      if (WIFSIGNALED(status)) {
+        std::cerr << "was killed by signal " << WTERMSIG(status);
+      } else {
+        std::cerr << "exited with code " << WEXITSTATUS(status);
+      }
+      std::cerr << (waiting ? ", restarting it" : "") << std::endl;
+    }
+  }
+
+  for (const auto pid : workers) {
+    if (pid > 0) {
+      kill(pid, SIGTERM);
+    }
+  }
+  while (waitpid(-1, nullptr, 0) > 0 || errno == EINTR) {}
+  return -1;
+}
 #else
 bool waiting = false;
 bool libraryMustBeReloaded = false;
+bool libraryReloadForced = false;
 #endif
 
 uint64_t fileModificationTime(const std::string& path)
@@ -166,15 +356,27 @@ uint64_t newestFileTimestamp(const std::vector<std::string>& paths)
   return t;
 }
 
-bool reloadLibrary(kiwix::Manager& mgr, const std::vector<std::string>& paths)
+std::ostream& operator<<(std::ostream& out, const LibraryDelta& delta)
+{
+  return out << delta.added << " book(s) added, "
+             << delta.removed << " removed, "
+             << delta.updated << " updated";
+}
+
+double secondsSince(std::chrono::steady_clock::time_point start)
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+bool reloadLibrary(LibraryReloader& reloader, const std::vector<std::string>& paths, LibraryDelta& delta, bool force = false)
 {
     try {
       std::cout << "Loading the library from the following files:\n";
       for ( const auto& p : paths ) {
         std::cout << "\t" << p << std::endl;
       }
-      mgr.reload(paths);
-      std::cout << "The library was successfully loaded." << std::endl;
+      delta = reloader.reload(paths, force);
+      std::cout << "The library was successfully loaded (" << delta << ")." << std::endl;
       return true;
     } catch ( const std::runtime_error& err ) {
       std::cerr << "ERROR: " << err.what() << std::endl;
@@ -183,6 +385,83 @@ bool reloadLibrary(kiwix::Manager& mgr, const std::vector<std::string>& paths)
     }
 }
 
+/* Returns false if the directory can't be scanned or if some ZIM files are
+ * invalid (their books are not served). */
+bool scanLibraryDir(LibraryScanner& scanner, const std::string& dir, unsigned int nbThreads, LibraryDelta& delta)
+{
+  std::cout << "Scanning the directory '" << dir << "' for ZIM files" << std::endl;
+  std::vector<std::string> invalidZims;
+  try {
+    delta = scanner.scan(nbThreads, invalidZims);
+  } catch ( const std::runtime_error& err ) {
+    std::cerr << "ERROR: " << err.what() << std::endl;
+    return false;
+  }
+  for ( const auto& path : invalidZims ) {
+    std::cerr << "Invalid ZIM file '" << path << "'" << std::endl;
+  }
+  std::cout << "The directory was successfully scanned (" << delta << ")." << std::endl;
+  return invalidZims.empty();
+}
+
+std::set<std::string> zimDirectories(const kiwix::Library& library)
+{
+  std::set<std::string> dirs;
+  for ( const auto& id : library.getBooksIds() ) {
+    const auto& path = library.getBookById(id).getPath();
+    if ( !path.empty() ) {
+      dirs.insert(std::filesystem::path(path).parent_path().string());
+    }
+  }
+  return dirs;
+}
+
+/* Add the ZIM files which appeared in a watched directory and remove the ones
+ * (previously added this way) which disappeared from it.
+ * `addedZims` maps the paths of the ZIM files added this way to their book ids.
+ * Returns true if the library was changed. */
+bool updateZimFiles(kiwix::Library& library,
+                    const LibraryReloader& reloader,
+                    std::map<std::string, std::string>& addedZims,
+                    const std::set<std::string>& zimFiles)
+{
+  bool libraryChanged = false;
+  for ( const auto& path : zimFiles ) {
+    const auto it = addedZims.find(path);
+    if ( it != addedZims.end() ) {
+      if ( !reloader.hasBook(it->second) ) {
+        library.removeBookById(it->second);
+        libraryChanged = true;
+        std::cout << "Removed the ZIM file '" << path << "'" << std::endl;
+      }
+      addedZims.erase(it);
+    }
+    if ( !kiwix::fileExists(path) ) {
+      continue;
+    }
+
+    try {
+      library.getBookByPath(path);
+      continue; // Already served
+    } catch ( const std::out_of_range& ) {}
+
+    const auto book = loadBook(path);
+    if ( !book ) {
+      std::cerr << "Skipping invalid '" << path << "' ...continuing" << std::endl;
+      continue;
+    }
+    try {
+      library.getBookById(book->getId());
+      continue; // Already served from another path
+    } catch ( const std::out_of_range& ) {}
+    library.addBook(*book);
+    addedZims[path] = book->getId();
+    libraryChanged = true;
+    std::cout << "Added the ZIM file '" << path << "'" << std::endl;
+  }
+  return libraryChanged;
+}
+
 // docopt::value::isLong() is counting repeated values.
 // It doesn't check if the string can be parsed as long.
 // (Contrarly to `asLong` which will try to convert string to long)
@@ -212,10 +491,17 @@ int main(int argc, char** argv)
 #endif
 
   std::string rootLocation = "/";
-  auto library = kiwix::Library::create();
   unsigned int nb_threads = DEFAULT_THREADS;
+  unsigned int nb_load_threads = 0;
+  unsigned int cacheSize = 0;
+  unsigned int searchCacheSize = 0;
+  unsigned int archiveCacheSize = 0;
+  unsigned int searcherCacheSize = 0;
+  unsigned int suggestionCacheSize = 0;
   std::vector<std::string> zimPathes;
   std::string libraryPath;
+  std::string libraryDir;
+  std::string libraryDirCache;
   std::string rootPath;
   std::string address;
   std::string customIndexPath="";
@@ -236,6 +522,14 @@ int main(int argc, char** argv)
   int ipConnectionLimit = 0;
   int searchLimit = 0;
   bool skipInvalid = false;
+  int metricsPort = 0;
+  unsigned int nbWorkers = 0;
+  bool cpuAffinity = false;
+  unsigned int shutdownDelay = 0;
+  unsigned int shutdownTimeout = 10;
+  std::string warmupList;
+  std::string logFile;
+  std::string logFormat;
 
   std::string errorString;
 
@@ -262,14 +556,30 @@ int main(int argc, char** argv)
     FLAG("--skipInvalid", skipInvalid)
     FLAG("--version", versionFlag)
     STRING("LIBRARYPATH", libraryPath)
+    STRING("--libraryDir", libraryDir)
+    STRING("--libraryDirCache", libraryDirCache)
     INT("--port", serverPort, "Port must be an integer")
     INT("--attachToProcess", PPID, "Process to attach must be an integer")
     STRING("--address", address)
     INT("--threads", nb_threads, "Number of threads must be an integer")
+    INT("--loadThreads", nb_load_threads, "Number of load threads must be an integer")
+    INT("--cacheSize", cacheSize, "Cache size must be an integer")
+    INT("--searchCacheSize", searchCacheSize, "Search cache size must be an integer")
+    INT("--archiveCacheSize", archiveCacheSize, "Archive cache size must be an integer")
+    INT("--searcherCacheSize", searcherCacheSize, "Searcher cache size must be an integer")
+    INT("--suggestionCacheSize", suggestionCacheSize, "Suggestion cache size must be an integer")
     STRING("--urlRootLocation", rootLocation)
     STRING("--customIndex", customIndexPath)
     INT("--ipConnectionLimit", ipConnectionLimit, "IP connection limit must be an integer")
     INT("--searchLimit", searchLimit, "Search limit must be an integer")
+    INT("--metricsPort", metricsPort, "Metrics port must be an integer")
+    INT("--workers", nbWorkers, "Number of workers must be an integer")
+    FLAG("--cpuAffinity", cpuAffinity)
+    INT("--shutdownDelay", shutdownDelay, "Shutdown delay must be an integer")
+    INT("--shutdownTimeout", shutdownTimeout, "Shutdown timeout must be an integer")
+    STRING("--warmupList", warmupList)
+    STRING("--logFile", logFile)
+    STRING("--logFormat", logFormat)
     STRING_LIST("ZIMPATH", zimPathes, "ZIMPATH must be a string list")
  }
 
@@ -289,12 +599,65 @@ int main(int argc, char** argv)
    return 0;
  }
 
+ if (logFormat != "text" && logFormat != "json") {
+   std::cerr << "Log format must be 'text' or 'json'" << std::endl;
+   std::cerr << USAGE << std::endl;
+   return -1;
+ }
+
+ if (cpuAffinity && nbWorkers == 0) {
+   std::cerr << "--cpuAffinity can only be used together with --workers" << std::endl;
+   std::cerr << USAGE << std::endl;
+   return -1;
+ }
+
+#ifdef _WIN32
+ if (nbWorkers > 0) {
+   std::cerr << "--workers is not supported on Windows" << std::endl;
+   return -1;
+ }
+#endif
+
+ if (!libraryDir.empty() && !zimPathes.empty()) {
+   std::cerr << "ZIMPATH can't be used together with --libraryDir" << std::endl;
+   std::cerr << USAGE << std::endl;
+   return -1;
+ }
+
+ if (nb_load_threads == 0) {
+   nb_load_threads = nb_threads;
+ }
+
+ if (cacheSize > 0) {
+   zim::setClusterCacheMaxSize(size_t(cacheSize) << 20);
+ }
+
+ if (searchCacheSize > 0) {
+   setLibkiwixCacheSize("KIWIX_SEARCH_CACHE_SIZE", searchCacheSize);
+ }
+ if (archiveCacheSize > 0) {
+   setLibkiwixCacheSize("KIWIX_ARCHIVE_CACHE_SIZE", archiveCacheSize);
+ }
+ if (searcherCacheSize > 0) {
+   setLibkiwixCacheSize("KIWIX_SEARCHER_CACHE_SIZE", searcherCacheSize);
+ }
+ if (suggestionCacheSize > 0) {
+   setLibkiwixCacheSize("KIWIX_SUGGESTION_SEARCHER_CACHE_SIZE", suggestionCacheSize);
+ }
+
+  /* After setting the cache sizes, which are read by the library */
+  auto library = kiwix::Library::create();
+
   /* Setup the library manager and get the list of books */
-  kiwix::Manager manager(library);
+  const auto startupStart = std::chrono::steady_clock::now();
+  Metrics metrics(library);
+  LibraryReloader libraryReloader(library);
+  std::unique_ptr<LibraryScanner> libraryScanner;
   std::vector<std::string> libraryPaths;
   if (!libraryPath.empty()) {
     libraryPaths = kiwix::split(libraryPath, ";");
-    if ( !reloadLibrary(manager, libraryPaths) ) {
+    LibraryDelta delta;
+    if ( !reloadLibrary(libraryReloader, libraryPaths, delta) ) {
       exit(1);
     }
 
@@ -303,21 +666,41 @@ int main(int argc, char** argv)
       std::cerr << "The XML library file '" << libraryPath
            << "' is empty (or has only remote books)." << std::endl;
     }
+  } else if (!libraryDir.empty()) {
+    libraryScanner.reset(new LibraryScanner(library, libraryDir, libraryDirCache));
+    LibraryDelta delta;
+    if ( !scanLibraryDir(*libraryScanner, libraryDir, nb_load_threads, delta) && !skipInvalid ) {
+      std::cerr << "Unable to add all the ZIM files to the internal library." << std::endl;
+      exit(1);
+    }
   } else {
-    std::vector<std::string>::iterator it;
-    for (it = zimPathes.begin(); it != zimPathes.end(); it++) {
-      if (!manager.addBookFromPath(*it, *it, "", false)) {
+    /* Open the ZIM files in parallel, but add them in the given order */
+    const auto books = loadBooks(zimPathes, nb_load_threads);
+    for (size_t i = 0; i < zimPathes.size(); i++) {
+      if (!books[i]) {
         if (skipInvalid) {
-          std::cerr << "Skipping invalid '" << *it << "' ...continuing" << std::endl;
+          std::cerr << "Skipping invalid '" << zimPathes[i] << "' ...continuing" << std::endl;
+          continue;
         } else {
-          std::cerr << "Unable to add the ZIM file '" << *it
+          std::cerr << "Unable to add the ZIM file '" << zimPathes[i]
                << "' to the internal library." << std::endl;
           exit(1);
         }
       }
+      library->addBook(*books[i]);
     }
   }
-  auto libraryFileTimestamp = newestFileTimestamp(libraryPaths);
+  metrics.setStartupDuration(secondsSince(startupStart));
+
+  /* Files (or directories) to poll when the library can't be watched */
+  const auto monitoredPaths = [&]() {
+    if ( !libraryScanner ) {
+      return libraryPaths;
+    }
+    const auto& dirs = libraryScanner->getDirectories();
+    return std::vector<std::string>(dirs.begin(), dirs.end());
+  };
+  auto libraryFileTimestamp = newestFileTimestamp(monitoredPaths());
   auto curLibraryFileTimestamp = libraryFileTimestamp;
 
   kiwix::IpMode ipMode = kiwix::IpMode::AUTO;
@@ -350,8 +733,28 @@ int main(int argc, char** argv)
       exit(0);
     }
   }
+
+  /* Run the server in supervised worker processes, which inherit the loaded
+   * library, each one listening on its own port */
+  if (nbWorkers > 0) {
+    const int worker = superviseWorkers(nbWorkers, cpuAffinity, PPID);
+    if (worker < 0) {
+      return 0;
+    }
+    serverPort += worker;
+    if (metricsPort > 0) {
+      metricsPort += worker;
+    }
+    PPID = getppid();
+  }
 #endif
 
+  /* After the fork, as the log writer runs in a thread */
+  LogWriter logWriter(logFile, logFormat == "json" ? LogWriter::Format::JSON : LogWriter::Format::TEXT);
+  if (!logFile.empty() && !logWriter.start()) {
+    exit(1);
+  }
+
   auto nameMapper = std::make_shared<kiwix::UpdatableNameMapper>(library, noDateAliasesFlag);
   kiwix::Server server(library, nameMapper);
 
@@ -389,53 +792,107 @@ int main(int argc, char** argv)
     std::cout << "  - " << url << std::endl;
   }
 
+  CacheWarmer cacheWarmer(library, nameMapper);
+  if ( !warmupList.empty() && cacheWarmer.readUrlList(warmupList, rootLocation) ) {
+    cacheWarmer.start();
+  }
+
+  MetricsServer metricsServer(metrics);
+  if ( metricsPort > 0 ) {
+    const auto metricsAddress = ipMode == kiwix::IpMode::IPV4 ? "0.0.0.0"
+                              : ipMode == kiwix::IpMode::IPV6 ? "::"
+                              : address;
+    if ( !metricsServer.start(metricsAddress, metricsPort) ) {
+      server.stop();
+      exit(1);
+    }
+    std::cout << "Metrics are served on port " << metricsPort << " under /metrics" << std::endl;
+  }
+
+  LibraryWatcher libraryWatcher;
+  std::map<std::string, std::string> addedZims;
+  if ( monitorLibrary && !libraryPaths.empty() ) {
+    libraryWatcher.watchLibraryFiles(libraryPaths);
+    libraryWatcher.watchZimDirectories(zimDirectories(*library));
+  } else if ( monitorLibrary && libraryScanner ) {
+    libraryWatcher.watchZimDirectories(libraryScanner->getDirectories());
+  }
+  const bool pollLibrary = monitorLibrary && !libraryWatcher.isEventDriven();
+
   /* Run endless (until PPID dies) */
   waiting = true;
   do {
-    if (PPID > 0) {
-#ifdef _WIN32
-      HANDLE process = OpenProcess(SYNCHRONIZE, FALSE, PPID);
-      DWORD ret = WaitForSingleObject(process, 0);
-      CloseHandle(process);
-      if (ret == WAIT_TIMEOUT) {
-#elif __APPLE__
-      int mib[MIBSIZE];
-      struct kinfo_proc kp;
-      size_t len = sizeof(kp);
-
-      mib[0] = CTL_KERN;
-      mib[1] = KERN_PROC;
-      mib[2] = KERN_PROC_PID;
-      mib[3] = PPID;
+    if (PPID > 0 && !processIsRunning(PPID)) {
+      waiting = false;
+    }
 
-      int ret = sysctl(mib, MIBSIZE, &kp, &len, NULL, 0);
-      if (ret != -1 && len > 0) {
-#else /* Linux & co */
-      std::string procPath = "/proc/" + std::to_string(PPID);
-      if (access(procPath.c_str(), F_OK) != -1) {
-#endif
-      } else {
-        waiting = false;
+    /* Only wake up periodically if something has to be polled */
+    auto events = libraryWatcher.wait(PPID > 0 || pollLibrary ? 1000 : -1);
+    if ( events.overflow ) {
+      // Some events were lost, also check the ZIM files added so far
+      for ( const auto& added : addedZims ) {
+        events.zimFiles.insert(added.first);
       }
     }
 
-    kiwix::sleep(1000);
-
-    if ( monitorLibrary ) {
-      curLibraryFileTimestamp = newestFileTimestamp(libraryPaths);
+    if ( pollLibrary ) {
+      curLibraryFileTimestamp = newestFileTimestamp(monitoredPaths());
       if ( !libraryMustBeReloaded ) {
         libraryMustBeReloaded = curLibraryFileTimestamp > libraryFileTimestamp;
       }
+    } else if ( events.libraryChanged ) {
+      libraryMustBeReloaded = true;
+    } else if ( libraryScanner && !(events.zimFiles.empty() && events.directories.empty()) ) {
+      libraryMustBeReloaded = true;
     }
 
-    if ( libraryMustBeReloaded && !libraryPaths.empty() ) {
+    bool libraryChanged = false;
+    if ( libraryMustBeReloaded && (!libraryPaths.empty() || libraryScanner) ) {
+      const auto reloadStart = std::chrono::steady_clock::now();
+      LibraryDelta delta;
+      bool success;
       libraryFileTimestamp = curLibraryFileTimestamp;
-      reloadLibrary(manager, libraryPaths);
+      if ( !libraryPaths.empty() ) {
+        const bool force = libraryReloadForced;
+        libraryReloadForced = false;
+        success = reloadLibrary(libraryReloader, libraryPaths, delta, force);
+      } else {
+        success = scanLibraryDir(*libraryScanner, libraryDir, nb_load_threads, delta);
+        if ( monitorLibrary ) {
+          libraryWatcher.watchZimDirectories(libraryScanner->getDirectories());
+        }
+      }
+      metrics.libraryReloaded(success, secondsSince(reloadStart), delta);
+      libraryChanged = !delta.empty();
+    }
+    libraryMustBeReloaded = false;
+    if ( !libraryPaths.empty() && !events.zimFiles.empty() ) {
+      libraryChanged |= updateZimFiles(*library, libraryReloader, addedZims, events.zimFiles);
+    }
+    if ( libraryChanged ) {
       nameMapper->update();
-      libraryMustBeReloaded = false;
+      if ( monitorLibrary && !libraryPaths.empty() ) {
+        libraryWatcher.watchZimDirectories(zimDirectories(*library));
+      }
     }
   } while (waiting);
 
+  /* Keep serving while the load balancers notice (through /ready) that
+   * this instance is going away. A second signal exits immediately. */
+  metrics.setShuttingDown();
+  if ( shutdownDelay > 0 ) {
+    std::cout << "Shutting down in " << shutdownDelay << " seconds..." << std::endl;
+    std::this_thread::sleep_for(std::chrono::seconds(shutdownDelay));
+  }
+
   /* Stop the daemon */
-  server.stop();
+  cacheWarmer.stop();
+  if ( !stopServer(server, shutdownTimeout) ) {
+    std::cerr << "The running requests didn't complete within "
+              << shutdownTimeout << " seconds, exiting anyway." << std::endl;
+    logWriter.stop();
+    _exit(1);
+  }
+  metricsServer.stop();
+  logWriter.stop();
 }
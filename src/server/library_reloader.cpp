@@ -0,0 +1,129 @@
+/*
+ * Copyright 2026 Kiwix <contact@kiwix.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+
+#include "library_reloader.h"
+
+#include <kiwix/manager.h>
+#include <kiwix/tools.h>
+
+#include <filesystem>
+#include <stdexcept>
+
+#include "../binary_library.h"
+
+namespace
+{
+
+bool sameBook(const kiwix::Book& a, const kiwix::Book& b)
+{
+  return a.getPath() == b.getPath()
+      && a.isPathValid() == b.isPathValid()
+      && a.getUrl() == b.getUrl()
+      && a.getTitle() == b.getTitle()
+      && a.getName() == b.getName()
+      && a.getDescription() == b.getDescription()
+      && a.getLanguages() == b.getLanguages()
+      && a.getCreator() == b.getCreator()
+      && a.getPublisher() == b.getPublisher()
+      && a.getDate() == b.getDate()
+      && a.getFlavour() == b.getFlavour()
+      && a.getCategory() == b.getCategory()
+      && a.getTags() == b.getTags()
+      && a.getArticleCount() == b.getArticleCount()
+      && a.getMediaCount() == b.getMediaCount()
+      && a.getSize() == b.getSize()
+      && a.getDownloadId() == b.getDownloadId();
+}
+
+} // unnamed namespace
+
+LibraryReloader::LibraryReloader(kiwix::LibraryPtr library)
+  : mp_library(library)
+{}
+
+LibraryDelta LibraryReloader::reload(const std::vector<std::string>& paths, bool force)
+{
+  namespace fs = std::filesystem;
+
+  std::map<std::string, LibraryFile> files;
+  Books books;
+  for (std::string path : paths) {
+    if (path.empty()) {
+      continue;
+    }
+    if (kiwix::isRelativePath(path)) {
+      path = kiwix::computeAbsolutePath(kiwix::getCurrentDirectory(), path);
+    }
+
+    LibraryFile file;
+    std::error_code ec;
+    file.size = fs::file_size(path, ec);
+    if (!ec) {
+      file.mtime = fs::last_write_time(path, ec).time_since_epoch().count();
+    }
+    if (ec) {
+      throw std::runtime_error("Failed to load the XML library file '" + path + "'.");
+    }
+
+    const auto it = m_files.find(path);
+    if (!force && it != m_files.end() && it->second.mtime == file.mtime && it->second.size == file.size) {
+      file.books = it->second.books;
+    } else {
+      auto fileLibrary = kiwix::Library::create();
+      const bool loaded = BinaryLibrary::isBinaryLibrary(path)
+                        ? readBinaryLibrary(fileLibrary, path)
+                        : kiwix::Manager(fileLibrary).readFile(path, false, true);
+      if (!loaded) {
+        throw std::runtime_error("Failed to load the XML library file '" + path + "'.");
+      }
+      for (const auto& id : fileLibrary->getBooksIds()) {
+        file.books.emplace(id, fileLibrary->getBookById(id));
+      }
+    }
+
+    // As with kiwix::Manager::reload(), a book listed in several files
+    // takes its values from the last one.
+    for (const auto& entry : file.books) {
+      books.insert_or_assign(entry.first, entry.second);
+    }
+    files[path] = std::move(file);
+  }
+
+  LibraryDelta delta;
+  for (const auto& entry : m_books) {
+    if (books.find(entry.first) == books.end()) {
+      mp_library->removeBookById(entry.first);
+      delta.removed++;
+    }
+  }
+  for (const auto& entry : books) {
+    const auto it = m_books.find(entry.first);
+    if (it == m_books.end()) {
+      mp_library->addBook(entry.second);
+      delta.added++;
+    } else if (!sameBook(it->second, entry.second)) {
+      mp_library->addBook(entry.second);
+      delta.updated++;
+    }
+  }
+
+  m_files = std::move(files);
+  m_books = std::move(books);
+  return delta;
+}
@@ -0,0 +1,73 @@
+/*
+ * Copyright 2026 Kiwix <contact@kiwix.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+
+#ifndef _KIWIX_SERVE_LIBRARY_RELOADER_H_
+#define _KIWIX_SERVE_LIBRARY_RELOADER_H_
+
+#include <kiwix/library.h>
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+/* Number of books added, removed and modified in a live library */
+struct LibraryDelta {
+  unsigned int added = 0;
+  unsigned int removed = 0;
+  unsigned int updated = 0;
+
+  bool empty() const { return added == 0 && removed == 0 && updated == 0; }
+};
+
+/* Keeps a live library in sync with a set of XML library files.
+ *
+ * Contrary to kiwix::Manager::reload(), only the library files which changed
+ * since the previous reload are parsed again, and only the books which were
+ * added, removed or modified are touched in the live library. Books which
+ * didn't change keep their open archives and caches. */
+class LibraryReloader
+{
+ public:
+  explicit LibraryReloader(kiwix::LibraryPtr library);
+
+  /* Throws a std::runtime_error if one of the files can't be read, in which
+   * case the live library is left untouched.
+   * A file whose modification time and size didn't change is not parsed
+   * again, unless `force` is set. */
+  LibraryDelta reload(const std::vector<std::string>& paths, bool force = false);
+
+  /* Whether the book is listed in one of the library files */
+  bool hasBook(const std::string& id) const { return m_books.count(id) != 0; }
+
+ private:
+  typedef std::map<std::string, kiwix::Book> Books;
+
+  struct LibraryFile {
+    int64_t mtime = 0;
+    uintmax_t size = 0;
+    Books books;
+  };
+
+  kiwix::LibraryPtr mp_library;
+  std::map<std::string, LibraryFile> m_files;
+  Books m_books;
+};
+
+#endif //_KIWIX_SERVE_LIBRARY_RELOADER_H_
@@ -0,0 +1,204 @@
+/*
+ * Copyright 2026 Kiwix <contact@kiwix.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+
+#include "library_scanner.h"
+
+#include "../book_loader.h"
+
+#include <kiwix/manager.h>
+#include <kiwix/tools.h>
+
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+namespace fs = std::filesystem;
+
+LibraryScanner::LibraryScanner(kiwix::LibraryPtr library,
+                               const std::string& dir,
+                               const std::string& cachePath)
+  : mp_library(library),
+    m_dir(kiwix::isRelativePath(dir)
+            ? kiwix::computeAbsolutePath(kiwix::getCurrentDirectory(), dir)
+            : dir),
+    m_cachePath(cachePath)
+{
+  if (!m_cachePath.empty()) {
+    readCache();
+  }
+}
+
+void LibraryScanner::readCache()
+{
+  std::ifstream stamps(m_cachePath + ".stamps");
+  if (!stamps) {
+    return;
+  }
+  auto cacheLibrary = kiwix::Library::create();
+  kiwix::Manager manager(cacheLibrary);
+  if (!manager.readFile(m_cachePath, false, true)) {
+    std::cerr << "WARNING: Cannot read the library cache " << m_cachePath << std::endl;
+    return;
+  }
+
+  /* Each line is "<size> <mtime> <book id> <ZIM path>" */
+  std::string line;
+  while (std::getline(stamps, line)) {
+    std::istringstream ss(line);
+    ZimFile zimFile;
+    std::string id, path;
+    if (!(ss >> zimFile.size >> zimFile.mtime >> id) || !std::getline(ss >> std::ws, path)) {
+      continue;
+    }
+    try {
+      zimFile.book = cacheLibrary->getBookById(id);
+    } catch (const std::out_of_range&) {
+      continue;
+    }
+    m_cache[path] = zimFile;
+  }
+}
+
+void LibraryScanner::writeCache() const
+{
+  auto cacheLibrary = kiwix::Library::create();
+  std::ostringstream stamps;
+  for (const auto& entry : m_zims) {
+    const auto& zimFile = entry.second;
+    cacheLibrary->addBook(zimFile.book);
+    stamps << zimFile.size << " " << zimFile.mtime << " "
+           << zimFile.book.getId() << " " << entry.first << "\n";
+  }
+
+  const auto tmpPath = m_cachePath + ".tmp";
+  std::error_code ec;
+  if (cacheLibrary->writeToFile(tmpPath)) {
+    fs::rename(tmpPath, m_cachePath, ec);
+    if (!ec) {
+      std::ofstream stampsFile(tmpPath);
+      stampsFile << stamps.str();
+      stampsFile.close();
+      if (stampsFile) {
+        fs::rename(tmpPath, m_cachePath + ".stamps", ec);
+        if (!ec) {
+          return;
+        }
+      }
+    }
+  }
+  std::cerr << "WARNING: Cannot write the library cache " << m_cachePath << std::endl;
+}
+
+LibraryDelta LibraryScanner::scan(unsigned int nbThreads, std::vector<std::string>& invalidZims)
+{
+  ZimFiles zims;
+  std::vector<std::string> zimsToLoad;
+  std::set<std::string> dirs = { m_dir };
+  const auto& knownZims = m_zims.empty() ? m_cache : m_zims;
+
+  std::error_code ec;
+  const auto options = fs::directory_options::skip_permission_denied;
+  for (fs::recursive_directory_iterator it(m_dir, options, ec), end; !ec && it != end; it.increment(ec)) {
+    // An entry which can't be inspected (e.g. a dangling symlink) is skipped,
+    // without stopping the scan.
+    std::error_code entryEc;
+    if (it->is_directory(entryEc)) {
+      dirs.insert(it->path().string());
+      continue;
+    }
+    if (it->path().extension() != ".zim" || !it->is_regular_file(entryEc)) {
+      continue;
+    }
+
+    const auto path = it->path().string();
+    ZimFile zimFile;
+    zimFile.size = it->file_size(entryEc);
+    if (entryEc) {
+      continue;
+    }
+    zimFile.mtime = it->last_write_time(entryEc).time_since_epoch().count();
+    if (entryEc) {
+      continue;
+    }
+    const auto known = knownZims.find(path);
+    if (known != knownZims.end()
+     && known->second.size == zimFile.size
+     && known->second.mtime == zimFile.mtime) {
+      zimFile.book = known->second.book;
+    } else {
+      zimsToLoad.push_back(path);
+    }
+    zims[path] = zimFile;
+  }
+  if (ec) {
+    // The ZIM files not listed yet would be taken as removed
+    throw std::runtime_error("Cannot scan the directory " + m_dir + ": " + ec.message());
+  }
+
+  const auto books = loadBooks(zimsToLoad, nbThreads);
+  for (size_t i = 0; i < zimsToLoad.size(); i++) {
+    if (books[i]) {
+      zims[zimsToLoad[i]].book = *books[i];
+    } else {
+      invalidZims.push_back(zimsToLoad[i]);
+      zims.erase(zimsToLoad[i]);
+    }
+  }
+  const bool cacheOutdated = !zimsToLoad.empty() || zims.size() != knownZims.size();
+
+  /* Apply the difference (by book id) to the library. If the same ZIM file
+   * is present at several paths, the first one is served. */
+  std::map<std::string, const ZimFile*> oldBooks, newBooks;
+  for (const auto& entry : m_zims) {
+    oldBooks.emplace(entry.second.book.getId(), &entry.second);
+  }
+  for (const auto& entry : zims) {
+    newBooks.emplace(entry.second.book.getId(), &entry.second);
+  }
+
+  LibraryDelta delta;
+  for (const auto& entry : oldBooks) {
+    if (newBooks.find(entry.first) == newBooks.end()) {
+      mp_library->removeBookById(entry.first);
+      delta.removed++;
+    }
+  }
+  for (const auto& entry : newBooks) {
+    const auto old = oldBooks.find(entry.first);
+    if (old == oldBooks.end()) {
+      mp_library->addBook(entry.second->book);
+      delta.added++;
+    } else if (old->second->book.getPath() != entry.second->book.getPath()
+            || old->second->size != entry.second->size
+            || old->second->mtime != entry.second->mtime) {
+      mp_library->addBook(entry.second->book);
+      delta.updated++;
+    }
+  }
+
+  m_zims = std::move(zims);
+  m_cache.clear();
+  m_dirs = std::move(dirs);
+  if (cacheOutdated && !m_cachePath.empty()) {
+    writeCache();
+  }
+  return delta;
+}
@@ -0,0 +1,77 @@
+/*
+ * Copyright 2026 Kiwix <contact@kiwix.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+
+#ifndef _KIWIX_SERVE_LIBRARY_SCANNER_H_
+#define _KIWIX_SERVE_LIBRARY_SCANNER_H_
+
+#include "library_reloader.h"
+
+#include <kiwix/library.h>
+
+#include <cstdint>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+/* Keeps a live library in sync with the ZIM files found (recursively) in a
+ * directory.
+ *
+ * The books are identified by the path, size and modification time of their
+ * ZIM file: a ZIM file is only opened if it is new or was modified since the
+ * previous scan. If a cache path is given, the books are also saved there (as
+ * an XML library file, plus a `.stamps` file with the sizes and modification
+ * times), so that a restarted server doesn't need to open unchanged ZIM files
+ * either. */
+class LibraryScanner
+{
+ public:
+  LibraryScanner(kiwix::LibraryPtr library,
+                 const std::string& dir,
+                 const std::string& cachePath);
+
+  /* The paths of the ZIM files which can't be opened are appended to
+   * `invalidZims` and their books are not added to the library.
+   * Throws a std::runtime_error if the directory can't be walked through, in
+   * which case the library is left untouched. */
+  LibraryDelta scan(unsigned int nbThreads, std::vector<std::string>& invalidZims);
+
+  /* The directories found during the last scan */
+  const std::set<std::string>& getDirectories() const { return m_dirs; }
+
+ private:
+  struct ZimFile {
+    uintmax_t size = 0;
+    int64_t mtime = 0;
+    kiwix::Book book;
+  };
+  typedef std::map<std::string, ZimFile> ZimFiles;
+
+  void readCache();
+  void writeCache() const;
+
+  kiwix::LibraryPtr mp_library;
+  std::string m_dir;
+  std::string m_cachePath;
+  ZimFiles m_cache;
+  ZimFiles m_zims;
+  std::set<std::string> m_dirs;
+};
+
+#endif //_KIWIX_SERVE_LIBRARY_SCANNER_H_
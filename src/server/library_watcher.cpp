@@ -0,0 +1,308 @@
+/*
+ * Copyright 2026 Kiwix <contact@kiwix.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+
+#include "library_watcher.h"
+
+#include <kiwix/tools.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+
+#ifndef _WIN32
+# include <fcntl.h>
+# include <poll.h>
+# include <unistd.h>
+#endif
+#ifdef __linux__
+# include <sys/inotify.h>
+#endif
+
+/* Delay without new change after which a burst of changes is reported */
+#define DEBOUNCE_DELAY 100
+/* Maximum delay before reporting a never ending burst of changes */
+#define MAX_DEBOUNCE_DELAY 2000
+/* Delay between two checks of the paths which can't be watched */
+#define POLL_DELAY 1000
+
+namespace
+{
+
+#ifndef _WIN32
+int wakeupPipe[2] = {-1, -1};
+#endif
+
+bool isZimFile(const std::string& name)
+{
+  return name.size() > 4 && name.compare(name.size() - 4, 4, ".zim") == 0;
+}
+
+/* Modification time of a file or directory (following symlinks), 0 if it
+ * doesn't exist */
+int64_t modificationTime(const std::string& path)
+{
+  std::error_code ec;
+  const auto time = std::filesystem::last_write_time(path, ec);
+  return ec ? 0 : time.time_since_epoch().count();
+}
+
+std::set<std::string> listZimFiles(const std::string& dir)
+{
+  std::set<std::string> zimFiles;
+  std::error_code ec;
+  for (std::filesystem::directory_iterator it(dir, ec), end; !ec && it != end; it.increment(ec)) {
+    if (isZimFile(it->path().filename().string())) {
+      zimFiles.insert(it->path().string());
+    }
+  }
+  return zimFiles;
+}
+
+} // unnamed namespace
+
+LibraryWatcher::LibraryWatcher()
+{
+#ifndef _WIN32
+  if (wakeupPipe[0] < 0 && pipe(wakeupPipe) == 0) {
+    for (auto fd : wakeupPipe) {
+      fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+      fcntl(fd, F_SETFD, FD_CLOEXEC);
+    }
+  }
+#endif
+#ifdef __linux__
+  m_inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+#endif
+}
+
+LibraryWatcher::~LibraryWatcher()
+{
+#ifndef _WIN32
+  if (m_inotifyFd >= 0) {
+    close(m_inotifyFd);
+  }
+#endif
+}
+
+LibraryWatcher::Watch* LibraryWatcher::addWatch(const std::string& dir)
+{
+#ifdef __linux__
+  if (m_inotifyFd < 0) {
+    return nullptr;
+  }
+  const int wd = inotify_add_watch(m_inotifyFd, dir.c_str(),
+      IN_CREATE | IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE | IN_ONLYDIR);
+  if (wd < 0) {
+    std::cerr << "WARNING: Cannot watch the directory '" << dir << "' ("
+              << strerror(errno) << "), polling instead" << std::endl;
+    return nullptr;
+  }
+  auto& watch = m_watches[wd];
+  watch.dir = dir;
+  return &watch;
+#else
+  return nullptr;
+#endif
+}
+
+void LibraryWatcher::addPolledPath(const std::string& path, bool zimDir)
+{
+  if (m_inotifyFd < 0 || m_polledPaths.count(path)) {
+    // Without inotify at all, the caller polls everything
+    return;
+  }
+  auto& polledPath = m_polledPaths[path];
+  polledPath.zimDir = zimDir;
+  polledPath.mtime = modificationTime(path);
+  if (zimDir) {
+    polledPath.zimFiles = listZimFiles(path);
+  }
+}
+
+void LibraryWatcher::watchLibraryFiles(const std::vector<std::string>& paths)
+{
+  for (std::string path : paths) {
+    if (path.empty()) {
+      continue;
+    }
+    if (kiwix::isRelativePath(path)) {
+      path = kiwix::computeAbsolutePath(kiwix::getCurrentDirectory(), path);
+    }
+    // Watch the library file and, if it is a symlink, its target, which may
+    // be modified in another directory.
+    std::vector<std::filesystem::path> files = { path };
+    std::error_code ec;
+    if (std::filesystem::is_symlink(path, ec)) {
+      const auto target = std::filesystem::canonical(path, ec);
+      if (!ec) {
+        files.push_back(target);
+      }
+    }
+    for (const auto& file : files) {
+      if (auto watch = addWatch(file.parent_path().string())) {
+        watch->libraryFiles.insert(file.filename().string());
+      } else {
+        addPolledPath(file.string(), false);
+      }
+    }
+  }
+}
+
+void LibraryWatcher::watchZimDirectories(const std::set<std::string>& dirs)
+{
+  for (const auto& dir : dirs) {
+    if (m_polledPaths.count(dir)) {
+      continue;
+    }
+    if (auto watch = addWatch(dir)) {
+      watch->zimDir = true;
+    } else {
+      addPolledPath(dir, true);
+    }
+  }
+}
+
+void LibraryWatcher::readEvents(Events& events)
+{
+#ifdef __linux__
+  alignas(struct inotify_event) char buffer[4096];
+  ssize_t len;
+  while ((len = read(m_inotifyFd, buffer, sizeof(buffer))) > 0) {
+    for (char* p = buffer; p < buffer + len; ) {
+      const auto event = reinterpret_cast<const struct inotify_event*>(p);
+      p += sizeof(struct inotify_event) + event->len;
+      if (event->mask & IN_Q_OVERFLOW) {
+        events.overflow = true;
+        events.libraryChanged = true;
+        for (const auto& watch : m_watches) {
+          if (watch.second.zimDir) {
+            const auto zimFiles = listZimFiles(watch.second.dir);
+            events.zimFiles.insert(zimFiles.begin(), zimFiles.end());
+            events.directories.insert(watch.second.dir);
+          }
+        }
+        continue;
+      }
+      const auto it = m_watches.find(event->wd);
+      if (it == m_watches.end() || event->len == 0) {
+        continue;
+      }
+      const std::string name(event->name);
+      const auto& watch = it->second;
+      if (watch.libraryFiles.count(name)) {
+        events.libraryChanged = true;
+      }
+      if (!watch.zimDir) {
+        continue;
+      }
+      const auto path = (std::filesystem::path(watch.dir) / name).string();
+      if (event->mask & IN_ISDIR) {
+        events.directories.insert(path);
+      } else if (isZimFile(name) && !(event->mask & IN_CREATE)) {
+        // A created file is reported once closed (IN_CLOSE_WRITE)
+        events.zimFiles.insert(path);
+      }
+    }
+  }
+#endif
+}
+
+LibraryWatcher::Events LibraryWatcher::wait(int timeoutMs)
+{
+  Events events;
+#ifdef _WIN32
+  kiwix::sleep(timeoutMs < 0 ? 1000 : timeoutMs);
+#else
+  struct pollfd fds[2] = {
+    { wakeupPipe[0], POLLIN, 0 },
+    { m_inotifyFd, POLLIN, 0 }
+  };
+  const nfds_t nfds = m_inotifyFd >= 0 ? 2 : 1;
+  if (!m_polledPaths.empty()) {
+    timeoutMs = timeoutMs < 0 ? POLL_DELAY : std::min(timeoutMs, POLL_DELAY);
+  }
+  const auto start = std::chrono::steady_clock::now();
+  int totalDelay = 0;
+  int timeout = timeoutMs;
+  while (poll(fds, nfds, timeout) > 0) {
+    if (fds[0].revents & POLLIN) {
+      char c;
+      while (read(wakeupPipe[0], &c, 1) > 0) {}
+      break;
+    }
+    readEvents(events);
+    if (!events.libraryChanged && events.zimFiles.empty() && events.directories.empty()) {
+      // Nothing relevant happened (yet), keep on waiting for the rest of the
+      // timeout
+      if (timeoutMs >= 0) {
+        const std::chrono::duration<double, std::milli> waited = std::chrono::steady_clock::now() - start;
+        timeout = timeoutMs - int(waited.count());
+        if (timeout <= 0) {
+          break;
+        }
+      }
+      continue;
+    }
+    totalDelay += DEBOUNCE_DELAY;
+    if (totalDelay > MAX_DEBOUNCE_DELAY) {
+      break;
+    }
+    timeout = DEBOUNCE_DELAY;
+  }
+  checkPolledPaths(events);
+#endif
+  return events;
+}
+
+void LibraryWatcher::checkPolledPaths(Events& events)
+{
+  for (auto& entry : m_polledPaths) {
+    const auto& path = entry.first;
+    auto& polledPath = entry.second;
+    const auto mtime = modificationTime(path);
+    if (mtime == polledPath.mtime) {
+      continue;
+    }
+    polledPath.mtime = mtime;
+    if (!polledPath.zimDir) {
+      events.libraryChanged = true;
+      continue;
+    }
+    // Report the ZIM files which appeared or disappeared (and the ones which
+    // were kept, which the caller ignores)
+    auto zimFiles = listZimFiles(path);
+    events.zimFiles.insert(zimFiles.begin(), zimFiles.end());
+    events.zimFiles.insert(polledPath.zimFiles.begin(), polledPath.zimFiles.end());
+    events.directories.insert(path);
+    polledPath.zimFiles = std::move(zimFiles);
+  }
+}
+
+void LibraryWatcher::wakeUp()
+{
+#ifndef _WIN32
+  if (wakeupPipe[1] >= 0) {
+    const char c = 0;
+    [[maybe_unused]] auto ret = write(wakeupPipe[1], &c, 1);
+  }
+#endif
+}
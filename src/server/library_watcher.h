@@ -0,0 +1,96 @@
+/*
+ * Copyright 2026 Kiwix <contact@kiwix.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+
+#ifndef _KIWIX_SERVE_LIBRARY_WATCHER_H_
+#define _KIWIX_SERVE_LIBRARY_WATCHER_H_
+
+#include <cstdint>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+/* Waits for changes of the library files and of the directories containing
+ * the served ZIM files.
+ *
+ * On Linux, changes are reported through inotify. The directories (and not
+ * the files themselves) are watched, so that a library file replaced by an
+ * atomic rename is still noticed. The files and directories which can't be
+ * watched (e.g. when the inotify watch limit is reached) are polled by wait().
+ * Elsewhere (or if inotify is not available) isEventDriven() returns false and
+ * the caller has to poll the files. */
+class LibraryWatcher
+{
+ public:
+  struct Events {
+    bool libraryChanged = false;
+    /* Some events were lost (the inotify queue overflowed): libraryChanged is
+     * set and zimFiles lists all the ZIM files of the watched directories. */
+    bool overflow = false;
+    /* ZIM files which were created, moved, or deleted in a watched directory */
+    std::set<std::string> zimFiles;
+    /* Directories which were created or moved in a watched directory */
+    std::set<std::string> directories;
+  };
+
+  LibraryWatcher();
+  ~LibraryWatcher();
+  LibraryWatcher(const LibraryWatcher&) = delete;
+  LibraryWatcher& operator=(const LibraryWatcher&) = delete;
+
+  bool isEventDriven() const { return m_inotifyFd >= 0; }
+
+  void watchLibraryFiles(const std::vector<std::string>& paths);
+  /* Directories already watched are kept watched. */
+  void watchZimDirectories(const std::set<std::string>& dirs);
+
+  /* Wait for changes for at most `timeoutMs` milliseconds (forever if
+   * negative). Bursts of changes are reported at once, when no new change
+   * happened for a short while. Returns early after a call to wakeUp(). */
+  Events wait(int timeoutMs);
+
+  /* Interrupt wait(). This is async-signal-safe. */
+  static void wakeUp();
+
+ private:
+  struct Watch {
+    std::string dir;
+    std::set<std::string> libraryFiles;
+    bool zimDir = false;
+  };
+
+  /* A library file or a ZIM directory which can't be watched */
+  struct PolledPath {
+    bool zimDir = false;
+    int64_t mtime = 0;
+    /* ZIM files found in the directory at the previous check */
+    std::set<std::string> zimFiles;
+  };
+
+  Watch* addWatch(const std::string& dir);
+  void addPolledPath(const std::string& path, bool zimDir);
+  void readEvents(Events& events);
+  void checkPolledPaths(Events& events);
+
+  int m_inotifyFd = -1;
+  std::map<int, Watch> m_watches;
+  std::map<std::string, PolledPath> m_polledPaths;
+};
+
+#endif //_KIWIX_SERVE_LIBRARY_WATCHER_H_
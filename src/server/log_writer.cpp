@@ -0,0 +1,184 @@
+/*
+ * Copyright 2026 Kiwix <contact@kiwix.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+
+#include "log_writer.h"
+
+#include "../json.h"
+
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+
+#ifndef _WIN32
+# include <fcntl.h>
+# include <unistd.h>
+#endif
+
+namespace
+{
+
+volatile sig_atomic_t logMustBeReopened = false;
+
+/* ISO 8601 UTC timestamp with milliseconds */
+std::string timestamp()
+{
+  using namespace std::chrono;
+  const auto now = system_clock::now();
+  const auto t = system_clock::to_time_t(now);
+  const auto ms = duration_cast<milliseconds>(now.time_since_epoch()).count() % 1000;
+  struct tm tm;
+#ifdef _WIN32
+  gmtime_s(&tm, &t);
+#else
+  gmtime_r(&t, &tm);
+#endif
+  char buf[32];
+  const auto len = strftime(buf, sizeof(buf), "%Y-%m-%dT%H:%M:%S", &tm);
+  snprintf(buf + len, sizeof(buf) - len, ".%03dZ", static_cast<int>(ms));
+  return buf;
+}
+
+} // unnamed namespace
+
+LogWriter::LogWriter(const std::string& path, Format format)
+  : m_path(path),
+    m_format(format)
+{}
+
+LogWriter::~LogWriter()
+{
+  stop();
+}
+
+void LogWriter::reopen()
+{
+  logMustBeReopened = true;
+}
+
+#ifndef _WIN32
+bool LogWriter::start()
+{
+  mp_file = fopen(m_path.c_str(), "a");
+  if (!mp_file) {
+    std::cerr << "Unable to open the log file '" << m_path << "': " << strerror(errno) << std::endl;
+    return false;
+  }
+
+  int fds[2];
+  if (pipe(fds) != 0) {
+    std::cerr << "Unable to redirect the log: " << strerror(errno) << std::endl;
+    fclose(mp_file);
+    mp_file = nullptr;
+    return false;
+  }
+#ifdef F_SETPIPE_SZ
+  // Absorb bursts of log lines without blocking the writers
+  fcntl(fds[1], F_SETPIPE_SZ, 1 << 20);
+#endif
+  fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+
+  std::cout.flush();
+  fflush(stdout);
+  m_savedStdoutFd = dup(STDOUT_FILENO);
+  dup2(fds[1], STDOUT_FILENO);
+  close(fds[1]);
+  m_pipeFd = fds[0];
+
+  m_thread = std::thread(&LogWriter::run, this);
+  return true;
+}
+
+void LogWriter::stop()
+{
+  if (!m_thread.joinable()) {
+    return;
+  }
+  std::cout.flush();
+  fflush(stdout);
+  // Closing the last write end of the pipe makes the writer thread exit
+  dup2(m_savedStdoutFd, STDOUT_FILENO);
+  close(m_savedStdoutFd);
+  m_thread.join();
+  close(m_pipeFd);
+  fclose(mp_file);
+  mp_file = nullptr;
+}
+
+void LogWriter::run()
+{
+  char buffer[64 * 1024];
+  std::string pending;
+  ssize_t len;
+  while ((len = read(m_pipeFd, buffer, sizeof(buffer))) != 0) {
+    if (len < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      break;
+    }
+    if (logMustBeReopened) {
+      logMustBeReopened = false;
+      if (FILE* file = fopen(m_path.c_str(), "a")) {
+        fclose(mp_file);
+        mp_file = file;
+      }
+    }
+
+    pending.append(buffer, len);
+    size_t start = 0, end;
+    while ((end = pending.find('\n', start)) != std::string::npos) {
+      writeLine(pending.substr(start, end - start));
+      start = end + 1;
+    }
+    pending.erase(0, start);
+    fflush(mp_file);
+  }
+  if (!pending.empty()) {
+    writeLine(pending);
+  }
+  fflush(mp_file);
+}
+#else
+bool LogWriter::start()
+{
+  std::cerr << "The log file is not supported on Windows" << std::endl;
+  return false;
+}
+
+void LogWriter::stop()
+{
+}
+
+void LogWriter::run()
+{
+}
+#endif
+
+void LogWriter::writeLine(const std::string& line)
+{
+  std::string out;
+  if (m_format == Format::JSON) {
+    out = "{\"time\":" + jsonString(timestamp()) + ",\"message\":" + jsonString(line) + "}\n";
+  } else {
+    out = timestamp() + " " + line + "\n";
+  }
+  fwrite(out.data(), 1, out.size(), mp_file);
+}
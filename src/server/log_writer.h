@@ -0,0 +1,61 @@
+/*
+ * Copyright 2026 Kiwix <contact@kiwix.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+
+#ifndef _KIWIX_SERVE_LOG_WRITER_H_
+#define _KIWIX_SERVE_LOG_WRITER_H_
+
+#include <cstdio>
+#include <string>
+#include <thread>
+
+/* Redirects the standard output of the process to a log file.
+ *
+ * The standard output is replaced by a pipe, drained by a background thread
+ * which timestamps each line and appends it to the log file. The threads
+ * writing to the standard output only wait for the disk when the pipe is
+ * full, and still serialize on std::cout. */
+class LogWriter
+{
+ public:
+  enum class Format { TEXT, JSON };
+
+  LogWriter(const std::string& path, Format format);
+  ~LogWriter();
+
+  bool start();
+  /* Flush everything and restore the standard output */
+  void stop();
+
+  /* Make the writer reopen the log file before writing the next lines (for
+   * log rotation). This is async-signal-safe. */
+  static void reopen();
+
+ private:
+  void run();
+  void writeLine(const std::string& line);
+
+  const std::string m_path;
+  const Format m_format;
+  FILE* mp_file = nullptr;
+  int m_pipeFd = -1;
+  int m_savedStdoutFd = -1;
+  std::thread m_thread;
+};
+
+#endif //_KIWIX_SERVE_LOG_WRITER_H_
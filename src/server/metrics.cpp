@@ -0,0 +1,317 @@
+/*
+ * Copyright 2026 Kiwix <contact@kiwix.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+
+#include "metrics.h"
+
+#include <zim/archive.h>
+
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <sstream>
+
+#ifndef _WIN32
+# include <netdb.h>
+# include <netinet/in.h>
+# include <poll.h>
+# include <sys/socket.h>
+# include <fcntl.h>
+# include <unistd.h>
+#endif
+
+#ifndef MSG_NOSIGNAL
+# define MSG_NOSIGNAL 0
+#endif
+
+namespace
+{
+
+double now()
+{
+  using namespace std::chrono;
+  return duration<double>(system_clock::now().time_since_epoch()).count();
+}
+
+/* Number of ZIM files currently opened by the process (Linux only) */
+long openZimFileCount()
+{
+#ifdef __linux__
+  namespace fs = std::filesystem;
+  long count = 0;
+  std::error_code ec;
+  for (fs::directory_iterator it("/proc/self/fd", ec), end; !ec && it != end; it.increment(ec)) {
+    std::error_code linkEc;
+    const auto target = fs::read_symlink(it->path(), linkEc);
+    if (!linkEc && target.extension() == ".zim") {
+      count++;
+    }
+  }
+  return count;
+#else
+  return -1;
+#endif
+}
+
+void writeMetric(std::ostream& out, const char* name, const char* type,
+                 const char* help, double value)
+{
+  out << "# HELP " << name << " " << help << "\n"
+      << "# TYPE " << name << " " << type << "\n"
+      << name << " " << value << "\n";
+}
+
+} // unnamed namespace
+
+Metrics::Metrics(kiwix::LibraryPtr library)
+  : mp_library(library),
+    m_startTime(now()),
+    m_startupDuration(0),
+    m_reloadSuccesses(0),
+    m_reloadFailures(0),
+    m_reloadDurationSum(0),
+    m_lastReloadDuration(0),
+    m_lastReloadSuccessTime(0),
+    m_booksAdded(0),
+    m_booksRemoved(0),
+    m_booksUpdated(0),
+    m_shuttingDown(false)
+{}
+
+void Metrics::libraryReloaded(bool success, double seconds, const LibraryDelta& delta)
+{
+  if (success) {
+    m_reloadSuccesses++;
+    m_lastReloadSuccessTime = now();
+  } else {
+    m_reloadFailures++;
+  }
+  m_reloadDurationSum = m_reloadDurationSum + seconds;
+  m_lastReloadDuration = seconds;
+  m_booksAdded += delta.added;
+  m_booksRemoved += delta.removed;
+  m_booksUpdated += delta.updated;
+}
+
+std::string Metrics::render() const
+{
+  std::ostringstream out;
+  out.precision(15);
+  out << "# HELP kiwix_serve_info Version of kiwix-serve\n"
+      << "# TYPE kiwix_serve_info gauge\n"
+      << "kiwix_serve_info{version=\"" << KIWIX_TOOLS_VERSION << "\"} 1\n";
+  writeMetric(out, "kiwix_serve_start_time_seconds", "gauge",
+              "Start time of kiwix-serve since the epoch", m_startTime);
+  writeMetric(out, "kiwix_serve_startup_duration_seconds", "gauge",
+              "Time spent loading the library at startup", m_startupDuration);
+  writeMetric(out, "kiwix_serve_shutting_down", "gauge",
+              "Whether kiwix-serve is draining its connections before exiting", m_shuttingDown ? 1 : 0);
+
+  out << "# HELP kiwix_library_books Number of books in the library\n"
+      << "# TYPE kiwix_library_books gauge\n"
+      << "kiwix_library_books{location=\"local\"} " << mp_library->getBookCount(true, false) << "\n"
+      << "kiwix_library_books{location=\"remote\"} " << mp_library->getBookCount(false, true) << "\n";
+
+  const auto openZims = openZimFileCount();
+  if (openZims >= 0) {
+    writeMetric(out, "kiwix_serve_open_zim_files", "gauge",
+                "Number of ZIM files currently open", openZims);
+  }
+
+  writeMetric(out, "kiwix_zim_cluster_cache_bytes", "gauge",
+              "Memory used by the cache of decompressed ZIM clusters", zim::getClusterCacheCurrentSize());
+  writeMetric(out, "kiwix_zim_cluster_cache_max_bytes", "gauge",
+              "Memory budget of the cache of decompressed ZIM clusters", zim::getClusterCacheMaxSize());
+
+  out << "# HELP kiwix_library_reloads_total Number of library reloads\n"
+      << "# TYPE kiwix_library_reloads_total counter\n"
+      << "kiwix_library_reloads_total{result=\"success\"} " << m_reloadSuccesses << "\n"
+      << "kiwix_library_reloads_total{result=\"failure\"} " << m_reloadFailures << "\n";
+  out << "# HELP kiwix_library_reload_duration_seconds Time spent reloading the library\n"
+      << "# TYPE kiwix_library_reload_duration_seconds summary\n"
+      << "kiwix_library_reload_duration_seconds_sum " << m_reloadDurationSum << "\n"
+      << "kiwix_library_reload_duration_seconds_count " << m_reloadSuccesses + m_reloadFailures << "\n";
+  writeMetric(out, "kiwix_library_last_reload_duration_seconds", "gauge",
+              "Duration of the last library reload", m_lastReloadDuration);
+  writeMetric(out, "kiwix_library_last_reload_success_time_seconds", "gauge",
+              "Time of the last successful library reload since the epoch", m_lastReloadSuccessTime);
+  out << "# HELP kiwix_library_book_changes_total Number of books changed by library reloads\n"
+      << "# TYPE kiwix_library_book_changes_total counter\n"
+      << "kiwix_library_book_changes_total{change=\"added\"} " << m_booksAdded << "\n"
+      << "kiwix_library_book_changes_total{change=\"removed\"} " << m_booksRemoved << "\n"
+      << "kiwix_library_book_changes_total{change=\"updated\"} " << m_booksUpdated << "\n";
+  return out.str();
+}
+
+MetricsServer::MetricsServer(const Metrics& metrics)
+  : m_metrics(metrics)
+{}
+
+MetricsServer::~MetricsServer()
+{
+  stop();
+}
+
+#ifndef _WIN32
+bool MetricsServer::start(const std::string& address, int port)
+{
+  struct addrinfo hints;
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = address.empty() ? AF_INET6 : AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  hints.ai_flags = AI_PASSIVE | AI_NUMERICHOST;
+  struct addrinfo* addresses = nullptr;
+  const auto service = std::to_string(port);
+  if (getaddrinfo(address.empty() ? nullptr : address.c_str(), service.c_str(), &hints, &addresses) != 0) {
+    std::cerr << "Invalid metrics address '" << address << "'" << std::endl;
+    return false;
+  }
+
+  for (auto ai = addresses; ai && m_listenFd < 0; ai = ai->ai_next) {
+    const int fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+    if (fd < 0) {
+      continue;
+    }
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+    const int on = 1, off = 0;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    if (ai->ai_family == AF_INET6 && address.empty()) {
+      // Accept IPv4 connections too
+      setsockopt(fd, IPPROTO_IPV6, IPV6_V6ONLY, &off, sizeof(off));
+    }
+    if (bind(fd, ai->ai_addr, ai->ai_addrlen) == 0 && listen(fd, 16) == 0) {
+      m_listenFd = fd;
+    } else {
+      close(fd);
+    }
+  }
+  freeaddrinfo(addresses);
+
+  if (m_listenFd < 0 || pipe(m_stopPipe) != 0) {
+    std::cerr << "Unable to listen for metrics requests on port " << port
+              << ": " << strerror(errno) << std::endl;
+    return false;
+  }
+  m_thread = std::thread(&MetricsServer::run, this);
+  return true;
+}
+
+void MetricsServer::stop()
+{
+  if (m_thread.joinable()) {
+    const char c = 0;
+    [[maybe_unused]] auto ret = write(m_stopPipe[1], &c, 1);
+    m_thread.join();
+  }
+  for (auto fd : { m_listenFd, m_stopPipe[0], m_stopPipe[1] }) {
+    if (fd >= 0) {
+      close(fd);
+    }
+  }
+  m_listenFd = m_stopPipe[0] = m_stopPipe[1] = -1;
+}
+
+void MetricsServer::run()
+{
+  struct pollfd fds[2] = {
+    { m_listenFd, POLLIN, 0 },
+    { m_stopPipe[0], POLLIN, 0 }
+  };
+  while (true) {
+    if (poll(fds, 2, -1) < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      break;
+    }
+    if (fds[1].revents) {
+      break;
+    }
+    const int fd = accept(m_listenFd, nullptr, nullptr);
+    if (fd >= 0) {
+      handleConnection(fd);
+      close(fd);
+    }
+  }
+}
+
+void MetricsServer::handleConnection(int fd)
+{
+  // Don't let a slow client block the metrics server
+  struct timeval timeout = { 1, 0 };
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+  setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+#ifdef SO_NOSIGPIPE
+  const int on = 1;
+  setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+
+  std::string request;
+  char buffer[1024];
+  ssize_t len;
+  while (request.find("\r\n\r\n") == std::string::npos && request.size() < 8192
+      && (len = read(fd, buffer, sizeof(buffer))) > 0) {
+    request.append(buffer, len);
+  }
+
+  std::string status = "200 OK";
+  std::string body;
+  const bool head = request.compare(0, 5, "HEAD ") == 0;
+  if (request.compare(0, 13, "GET /metrics ") == 0 || request.compare(0, 14, "HEAD /metrics ") == 0) {
+    body = m_metrics.render();
+  } else if (request.compare(0, 11, "GET /ready ") == 0 || request.compare(0, 12, "HEAD /ready ") == 0) {
+    if (m_metrics.isReady()) {
+      body = "ready\n";
+    } else {
+      status = "503 Service Unavailable";
+      body = "shutting down\n";
+    }
+  } else {
+    status = "404 Not Found";
+    body = "Not Found\n";
+  }
+
+  std::ostringstream response;
+  response << "HTTP/1.1 " << status << "\r\n"
+           << "Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+           << "Content-Length: " << body.size() << "\r\n"
+           << "Connection: close\r\n\r\n";
+  if (!head) {
+    response << body;
+  }
+  const auto data = response.str();
+  for (size_t sent = 0; sent < data.size(); ) {
+    const auto ret = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+    if (ret <= 0) {
+      break;
+    }
+    sent += ret;
+  }
+}
+#else
+bool MetricsServer::start(const std::string& address, int port)
+{
+  std::cerr << "The metrics server is not supported on Windows" << std::endl;
+  return false;
+}
+
+void MetricsServer::stop()
+{
+}
+#endif
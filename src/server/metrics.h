@@ -0,0 +1,84 @@
+/*
+ * Copyright 2026 Kiwix <contact@kiwix.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+
+#ifndef _KIWIX_SERVE_METRICS_H_
+#define _KIWIX_SERVE_METRICS_H_
+
+#include "library_reloader.h"
+
+#include <kiwix/library.h>
+
+#include <atomic>
+#include <string>
+#include <thread>
+
+/* Counters of kiwix-serve, rendered in the Prometheus text format.
+ * Updates are done by the main thread, rendering by the metrics server. */
+class Metrics
+{
+ public:
+  explicit Metrics(kiwix::LibraryPtr library);
+
+  void setStartupDuration(double seconds) { m_startupDuration = seconds; }
+  void libraryReloaded(bool success, double seconds, const LibraryDelta& delta);
+
+  /* Once shutting down, the /ready endpoint answers 503 so that load
+   * balancers stop sending new requests while the current ones complete */
+  void setShuttingDown() { m_shuttingDown = true; }
+  bool isReady() const { return !m_shuttingDown; }
+
+  std::string render() const;
+
+ private:
+  kiwix::LibraryPtr mp_library;
+  const double m_startTime;
+  std::atomic<double> m_startupDuration;
+  std::atomic<unsigned long> m_reloadSuccesses;
+  std::atomic<unsigned long> m_reloadFailures;
+  std::atomic<double> m_reloadDurationSum;
+  std::atomic<double> m_lastReloadDuration;
+  std::atomic<double> m_lastReloadSuccessTime;
+  std::atomic<unsigned long> m_booksAdded;
+  std::atomic<unsigned long> m_booksRemoved;
+  std::atomic<unsigned long> m_booksUpdated;
+  std::atomic<bool> m_shuttingDown;
+};
+
+/* Minimal HTTP server answering `GET /metrics` and `GET /ready` on its own port */
+class MetricsServer
+{
+ public:
+  explicit MetricsServer(const Metrics& metrics);
+  ~MetricsServer();
+
+  /* An empty address means all the addresses */
+  bool start(const std::string& address, int port);
+  void stop();
+
+ private:
+  void run();
+  void handleConnection(int fd);
+
+  const Metrics& m_metrics;
+  int m_listenFd = -1;
+  int m_stopPipe[2] = {-1, -1};
+  std::thread m_thread;
+};
+
+#endif //_KIWIX_SERVE_METRICS_H_
@@ -0,0 +1,28 @@
+#!/usr/bin/env python3
+# Check that converting a library to the binary format and back to XML is
+# lossless: the XML written from the binary library must be the same as the
+# XML written from the original library.
+
+import filecmp
+import os
+import subprocess
+import sys
+import tempfile
+
+kiwix_manage, library = sys.argv[1:3]
+
+with tempfile.TemporaryDirectory() as tmp:
+    direct = os.path.join(tmp, 'direct.xml')
+    binary = os.path.join(tmp, 'library.kwl')
+    round_trip = os.path.join(tmp, 'round_trip.xml')
+
+    subprocess.run([kiwix_manage, library, 'convert', direct], check=True)
+    subprocess.run([kiwix_manage, library, 'convert', '--binary', binary], check=True)
+    subprocess.run([kiwix_manage, binary, 'convert', round_trip], check=True)
+
+    if not filecmp.cmp(direct, round_trip, shallow=False):
+        with open(direct) as f:
+            print(f.read())
+        with open(round_trip) as f:
+            print(f.read())
+        sys.exit('The XML -> binary -> XML conversion changed the library')